@@ -6,14 +6,30 @@
  */
 
 #include "image_video_ar.h"
+#include "../../include/thread_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <future>
 #include <iostream>
+#include <mutex>
 #include <sstream>
+#include <thread>
+#include <vector>
 
 ImageVideoAR::ImageVideoAR(int boardWidth, int boardHeight)
     : ar(boardWidth, boardHeight),
+      boardSize(boardWidth, boardHeight),
       isPaused(false),
       currentFrame(0),
-      isVideo(false) {
+      isVideo(false),
+      telemetry(std::chrono::milliseconds(200)) {
+    // High-resolution inputs: search a downscaled frame and refine at full resolution
+    ar.setMultiScaleEnabled(true);
+    ar.setTelemetrySink(&telemetry);
 }
 
 bool ImageVideoAR::processImage(const std::string& imagePath) {
@@ -45,8 +61,8 @@ bool ImageVideoAR::processImage(const std::string& imagePath) {
     std::cout << "5. Press ESC to exit" << std::endl;
     
     while (true) {
-        cv::Mat frame = image.clone();
-        processFrame(frame);
+        // The image never changes, so detection only reruns after a key changed the state
+        cv::imshow("AR Image Processing", renderFrame(image));
         
         char key = (char)cv::waitKey(30);
         if (key == 27) { // ESC
@@ -55,6 +71,7 @@ bool ImageVideoAR::processImage(const std::string& imagePath) {
             if (ar.getCorners().size() > 0) {
                 std::cout << "Saving calibration frame..." << std::endl;
                 ar.saveCalibrationData();
+                changeGate.invalidate();
                 std::cout << "Frame saved. Total frames: " << ar.getSavedFramesCount() << std::endl;
             } else {
                 std::cout << "No chessboard detected - cannot save frame" << std::endl;
@@ -63,6 +80,7 @@ bool ImageVideoAR::processImage(const std::string& imagePath) {
             if (ar.getSavedFramesCount() >= 5) {
                 std::cout << "Calibrating camera..." << std::endl;
                 ar.calibrateCamera();
+                changeGate.invalidate();
             } else {
                 std::cout << "Need at least 5 frames for calibration. Currently have: " 
                          << ar.getSavedFramesCount() << std::endl;
@@ -102,10 +120,9 @@ bool ImageVideoAR::processVideo(const std::string& videoPath) {
             currentFrame = videoCapture.get(cv::CAP_PROP_POS_FRAMES);
         }
 
+        // A paused or static video shows the cached result instead of detecting again
         if (!frame.empty()) {
-            cv::Mat processedFrame = frame.clone();
-            processFrame(processedFrame);
-            cv::imshow("AR Video Processing", processedFrame);
+            cv::imshow("AR Video Processing", renderFrame(frame));
         }
 
         char key = (char)cv::waitKey(KEY_WAIT_TIME);
@@ -121,6 +138,7 @@ bool ImageVideoAR::processVideo(const std::string& videoPath) {
             case 'S':
                 if (ar.getCorners().size() > 0) {  // If chessboard is detected
                     ar.saveCalibrationData();
+                    changeGate.invalidate();
                     std::cout << "Frame " << currentFrame << " saved. Total frames: " 
                              << ar.getSavedFramesCount() << std::endl;
                     if (ar.getSavedFramesCount() >= 5) {
@@ -136,6 +154,7 @@ bool ImageVideoAR::processVideo(const std::string& videoPath) {
                 if (ar.getSavedFramesCount() >= 5) {
                     std::cout << "Calibrating camera..." << std::endl;
                     ar.calibrateCamera();
+                    changeGate.invalidate();
                     if (ar.isCalibrated()) {
                         std::cout << "Calibration successful! Virtual object will now be displayed." << std::endl;
                     } else {
@@ -154,6 +173,241 @@ bool ImageVideoAR::processVideo(const std::string& videoPath) {
     return true;
 }
 
+// Consecutive frames processed together by one batch worker
+struct BatchChunk {
+    uint64_t firstFrame = 0;              // Index of the first frame in the video
+    std::vector<cv::Mat> frames;          // Decoded frames, annotated in place
+    std::vector<FrameStatus> statuses;    // Detection and pose per frame
+};
+
+// Detects and poses every frame of a chunk with a fresh tracker, so chunks are independent
+static BatchChunk processChunk(BatchChunk chunk, const cv::Size& boardSize,
+                               const cv::Mat& cameraMatrix, const cv::Mat& distCoeffs) {
+    AugmentedReality tracker(boardSize.width, boardSize.height);
+    tracker.setMultiScaleEnabled(true);
+    tracker.setTrackingMode(AugmentedReality::TrackingMode::ROI);
+    tracker.setPoseTrackingEnabled(true);
+    tracker.setSteadyStateMode(true);  // No calibration snapshots
+    if (!cameraMatrix.empty()) {
+        tracker.setCameraParameters(cameraMatrix, distCoeffs);
+    }
+
+    cv::Mat rvec, tvec;
+    chunk.statuses.resize(chunk.frames.size());
+    for (size_t i = 0; i < chunk.frames.size(); ++i) {
+        cv::Mat& frame = chunk.frames[i];
+        if (tracker.detectChessboard(frame) && tracker.isCalibrated() &&
+            tracker.computePose(rvec, tvec)) {
+            tracker.drawVirtualObject(frame, rvec, tvec, tracker.getFrameStatus().undistorted);
+        }
+        tracker.drawOverlay(frame);
+        chunk.statuses[i] = tracker.getFrameStatus();
+        chunk.statuses[i].frameIndex = chunk.firstFrame + i;
+    }
+    return chunk;
+}
+
+bool ImageVideoAR::processVideoBatch(const std::string& videoPath, const std::string& outputPath,
+                                     const std::string& posesPath, const std::string& cameraParamsPath,
+                                     size_t threadCount, size_t chunkFrames) {
+    cv::VideoCapture capture;
+    if (!capture.open(videoPath)) {
+        std::cerr << "Error: Could not open video: " << videoPath << std::endl;
+        return false;
+    }
+
+    cv::Mat cameraMatrix, distCoeffs;
+    if (!cameraParamsPath.empty()) {
+        cv::FileStorage fs(cameraParamsPath, cv::FileStorage::READ);
+        if (fs.isOpened()) {
+            fs["camera_matrix"] >> cameraMatrix;
+            fs["dist_coeffs"] >> distCoeffs;
+        }
+        if (cameraMatrix.rows != 3 || cameraMatrix.cols != 3) {
+            std::cerr << "No camera_matrix in " << cameraParamsPath << std::endl;
+            cameraMatrix.release();
+        }
+    }
+    if (cameraMatrix.empty()) {
+        std::cout << "No camera parameters - detecting corners only, poses are not estimated" << std::endl;
+    }
+
+    std::FILE* posesFile = nullptr;
+    if (!posesPath.empty()) {
+        posesFile = std::fopen(posesPath.c_str(), "w");
+        if (posesFile == nullptr) {
+            std::cerr << "Failed to open file: " << posesPath << std::endl;
+            return false;
+        }
+        std::fputs("frame,found,pose_valid,rvec_x,rvec_y,rvec_z,tvec_x,tvec_y,tvec_z\n", posesFile);
+    }
+
+    double fps = capture.get(cv::CAP_PROP_FPS);
+    if (!(fps > 0.0)) {
+        fps = 30.0;
+    }
+    const double totalFrames = capture.get(cv::CAP_PROP_FRAME_COUNT);
+    chunkFrames = std::max<size_t>(1, chunkFrames);
+
+    ThreadPool pool(threadCount);
+    const size_t maxInFlight = pool.size() + 2;
+    std::deque<std::future<BatchChunk>> pending;  // Submitted chunks in frame order
+    std::mutex pendingMutex;
+    std::condition_variable pendingChanged;
+    bool readingDone = false;
+
+    // Writer: takes the chunks in frame order, whichever worker finished first
+    cv::VideoWriter writer;
+    bool writeFailed = false;
+    size_t failedChunks = 0;
+    uint64_t framesWritten = 0, framesFound = 0, framesPosed = 0;
+    auto start = std::chrono::steady_clock::now();
+    std::thread writerThread([&]() {
+        while (true) {
+            std::future<BatchChunk> next;
+            {
+                std::unique_lock<std::mutex> lock(pendingMutex);
+                pendingChanged.wait(lock, [&] { return !pending.empty() || readingDone; });
+                if (pending.empty()) {
+                    return;
+                }
+                next = std::move(pending.front());
+                pending.pop_front();
+            }
+            pendingChanged.notify_all();
+
+            // Anything a chunk throws (cv::Exception, std::bad_alloc, ...) must stay in this
+            // thread; an escaping exception would terminate the process and lose the poses file
+            BatchChunk chunk;
+            try {
+                chunk = next.get();
+            } catch (const std::exception& e) {
+                std::cerr << "\nFailed to process a chunk: " << e.what() << std::endl;
+                ++failedChunks;
+                continue;
+            } catch (...) {
+                std::cerr << "\nFailed to process a chunk: unknown exception" << std::endl;
+                ++failedChunks;
+                continue;
+            }
+
+            for (size_t i = 0; i < chunk.frames.size(); ++i) {
+                if (!outputPath.empty() && !writeFailed) {
+                    try {
+                        if (!writer.isOpened() &&
+                            !writer.open(outputPath, cv::VideoWriter::fourcc('m', 'p', '4', 'v'), fps,
+                                         chunk.frames[i].size())) {
+                            std::cerr << "\nFailed to open video writer: " << outputPath << std::endl;
+                            writeFailed = true;
+                        } else {
+                            writer.write(chunk.frames[i]);
+                        }
+                    } catch (const std::exception& e) {
+                        // cv::Exception from the backend, bad_alloc, ...
+                        std::cerr << "\nFailed to write video: " << e.what() << std::endl;
+                        writeFailed = true;
+                    } catch (...) {
+                        std::cerr << "\nFailed to write video: unknown exception" << std::endl;
+                        writeFailed = true;
+                    }
+                }
+
+                const FrameStatus& status = chunk.statuses[i];
+                framesFound += status.patternFound ? 1 : 0;
+                framesPosed += status.poseValid ? 1 : 0;
+                if (posesFile != nullptr) {
+                    std::fprintf(posesFile, "%llu,%d,%d", static_cast<unsigned long long>(status.frameIndex),
+                                 status.patternFound ? 1 : 0, status.poseValid ? 1 : 0);
+                    if (status.poseValid) {
+                        std::fprintf(posesFile, ",%.9g,%.9g,%.9g,%.9g,%.9g,%.9g\n",
+                                     status.rvec[0], status.rvec[1], status.rvec[2],
+                                     status.tvec[0], status.tvec[1], status.tvec[2]);
+                    } else {
+                        std::fputs(",,,,,,\n", posesFile);
+                    }
+                }
+            }
+            framesWritten += chunk.frames.size();
+
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "\rProcessed " << framesWritten;
+            if (totalFrames > 0) {
+                std::cout << "/" << static_cast<uint64_t>(totalFrames);
+            }
+            std::cout << " frames (" << static_cast<int>(framesWritten / std::max(elapsed, 1e-3))
+                      << " fps)" << std::flush;
+        }
+    });
+
+    // Reader: decoding is sequential, everything after it runs on the pool
+    uint64_t frameIndex = 0;
+    bool endOfVideo = false;
+    while (!endOfVideo) {
+        BatchChunk chunk;
+        chunk.firstFrame = frameIndex;
+        chunk.frames.reserve(chunkFrames);
+        while (chunk.frames.size() < chunkFrames) {
+            cv::Mat frame;
+            if (!capture.read(frame) || frame.empty()) {
+                endOfVideo = true;
+                break;
+            }
+            chunk.frames.push_back(frame);
+        }
+        if (chunk.frames.empty()) {
+            break;
+        }
+        frameIndex += chunk.frames.size();
+
+        // Bound memory: wait while the writer is too far behind
+        std::unique_lock<std::mutex> lock(pendingMutex);
+        pendingChanged.wait(lock, [&] { return pending.size() < maxInFlight; });
+        const cv::Size board = boardSize;
+        pending.push_back(pool.submit([chunk = std::move(chunk), board, cameraMatrix, distCoeffs]() mutable {
+            return processChunk(std::move(chunk), board, cameraMatrix, distCoeffs);
+        }));
+        lock.unlock();
+        pendingChanged.notify_all();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        readingDone = true;
+    }
+    pendingChanged.notify_all();
+    writerThread.join();
+    capture.release();
+    writer.release();
+    if (posesFile != nullptr) {
+        std::fclose(posesFile);
+    }
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "\n\nBatch summary:" << std::endl;
+    std::cout << "- Frames: " << framesWritten << " in " << elapsed << " s ("
+              << framesWritten / std::max(elapsed, 1e-3) << " fps on " << pool.size() << " threads)" << std::endl;
+    std::cout << "- Chessboard found: " << framesFound << ", pose estimated: " << framesPosed << std::endl;
+    if (!outputPath.empty() && !writeFailed) {
+        std::cout << "- Annotated video: " << outputPath << std::endl;
+    }
+    if (!posesPath.empty()) {
+        std::cout << "- Poses: " << posesPath << std::endl;
+    }
+    if (failedChunks > 0) {
+        std::cout << "- Chunks that failed: " << failedChunks << std::endl;
+    }
+    return !writeFailed && failedChunks == 0;
+}
+
+const cv::Mat& ImageVideoAR::renderFrame(const cv::Mat& input) {
+    if (changeGate.isUnchanged(input) && !renderedFrame.empty()) {
+        return renderedFrame;
+    }
+    input.copyTo(renderedFrame);
+    processFrame(renderedFrame);
+    return renderedFrame;
+}
+
 void ImageVideoAR::processFrame(cv::Mat& frame) {
     bool patternFound = ar.detectChessboard(frame);
     
@@ -161,9 +415,11 @@ void ImageVideoAR::processFrame(cv::Mat& frame) {
     if (patternFound && ar.isCalibrated()) {
         cv::Mat rvec, tvec;
         if (ar.computePose(rvec, tvec)) {
-            ar.drawVirtualObject(frame, rvec, tvec);
+            ar.drawVirtualObject(frame, rvec, tvec, ar.getFrameStatus().undistorted);
         }
     }
+    ar.finishFrame();
+    ar.drawOverlay(frame);
 
     // Display status at the top-right corner
     int rightX = frame.cols - 400;  // X position for right-aligned text
@@ -191,8 +447,6 @@ void ImageVideoAR::processFrame(cv::Mat& frame) {
     cv::putText(frame, calibMsg, cv::Point(rightX, startY + lineHeight),
                 cv::FONT_HERSHEY_SIMPLEX, 0.7,
                 cv::Scalar(0, 255, 0), 2);
-
-    cv::imshow(isVideo ? "AR Video Processing" : "AR Image Processing", frame);
 }
 
 void ImageVideoAR::nextFrame() {
@@ -201,6 +455,7 @@ void ImageVideoAR::nextFrame() {
         if (videoCapture.read(frame)) {
             currentFrame++;
             processFrame(frame);
+            cv::imshow("AR Video Processing", frame);
         }
     }
 }
@@ -212,6 +467,7 @@ void ImageVideoAR::previousFrame() {
         cv::Mat frame;
         if (videoCapture.read(frame)) {
             processFrame(frame);
+            cv::imshow("AR Video Processing", frame);
         }
     }
 }
@@ -9,6 +9,7 @@
 #define IMAGE_VIDEO_AR_H
 
 #include "../../include/augmented_reality.h"
+#include "../../include/frame_change_gate.h"
 #include <opencv2/opencv.hpp>
 #include <string>
 
@@ -20,6 +21,24 @@ public:
     // Main processing functions
     bool processImage(const std::string& imagePath);  // Process a single image
     bool processVideo(const std::string& videoPath);  // Process a video file
+
+    /**
+     * @brief Processes a whole video without a window as fast as the cores allow. Frames are
+     *        decoded in order and handed out in chunks of consecutive frames; each chunk is
+     *        detected and posed on a worker with its own tracker, and the results are written
+     *        back in frame order
+     * @param videoPath Input video file
+     * @param outputPath Annotated output video, or empty to skip encoding
+     * @param posesPath Per-frame detection and pose CSV, or empty to skip it
+     * @param cameraParamsPath File with camera_matrix and dist_coeffs (camera_params.yml);
+     *        if empty or unreadable only corners are detected
+     * @param threadCount Worker threads, 0 for all cores
+     * @param chunkFrames Frames per chunk; at most workers + 2 chunks are held in memory
+     * @return false if the input or an output cannot be opened
+     */
+    bool processVideoBatch(const std::string& videoPath, const std::string& outputPath,
+                           const std::string& posesPath, const std::string& cameraParamsPath,
+                           size_t threadCount = 0, size_t chunkFrames = 64);
     
     // Video control functions
     void togglePause() { isPaused = !isPaused; }
@@ -28,13 +47,18 @@ public:
     
 private:
     AugmentedReality ar;           // Instance of the original AR system
+    cv::Size boardSize;            // Inner corners, used for the batch trackers
     cv::VideoCapture videoCapture; // Video capture object
     bool isPaused;                 // Flag for video pause state
     int currentFrame;              // Current frame counter
     bool isVideo;                  // Flag to indicate video mode
+    TelemetrySink telemetry;       // Prints the pose off the frame loop
+    FrameChangeGate changeGate;    // Detects repeated or static input
+    cv::Mat renderedFrame;         // Output for the last frame that changed
     
     // Helper functions
     void processFrame(cv::Mat& frame);
+    const cv::Mat& renderFrame(const cv::Mat& input);  // processFrame, skipped for unchanged input
     void displayControls() const;
     bool handleKeyboard();
 };
@@ -6,10 +6,47 @@
  */
 
 #include "image_video_ar.h"
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
 #include <string>
 
-int main() {
+// Headless batch mode: image_video_ar --batch VIDEO [options]
+static int runBatch(int argc, char** argv) {
+    std::string videoPath = argv[2];
+    std::string outputPath, posesPath, paramsPath;
+    int threads = 0, chunkFrames = 64;
+    for (int i = 3; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--output" && hasValue) {
+            outputPath = argv[++i];
+        } else if (arg == "--poses" && hasValue) {
+            posesPath = argv[++i];
+        } else if (arg == "--params" && hasValue) {
+            paramsPath = argv[++i];
+        } else if (arg == "--threads" && hasValue) {
+            threads = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--chunk" && hasValue) {
+            chunkFrames = std::max(1, std::atoi(argv[++i]));
+        } else {
+            std::cerr << "Usage: " << argv[0] << " --batch VIDEO [--output OUT.mp4] [--poses POSES.csv]"
+                      << " [--params camera_params.yml] [--threads N] [--chunk FRAMES]" << std::endl;
+            return -1;
+        }
+    }
+
+    ImageVideoAR imageVideoAR(9, 6);
+    return imageVideoAR.processVideoBatch(videoPath, outputPath, posesPath, paramsPath,
+                                          static_cast<size_t>(threads),
+                                          static_cast<size_t>(chunkFrames)) ? 0 : -1;
+}
+
+int main(int argc, char** argv) {
+    if (argc >= 3 && std::string(argv[1]) == "--batch") {
+        return runBatch(argc, argv);
+    }
+
     std::cout << "=== AR System with Image/Video Support ===" << std::endl;
     
     // Create AR object with 9x6 chessboard (inner corners)
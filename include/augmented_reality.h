@@ -9,18 +9,42 @@
 #define AUGMENTED_REALITY_H
 
 #include <opencv2/opencv.hpp>
+#include <future>
+#include <memory>
 #include <vector>
 #include <iostream>
 #include "csv_util.h"
+#include "telemetry.h"
+#include "latency_profiler.h"
+#include "quality_controller.h"
+#include "session_writer.h"
+#include "thread_pool.h"
+#include "virtual_scene.h"
 
 class AugmentedReality {
 public:
+    // How detectChessboard searches for the board once it was found on the previous frame
+    enum class TrackingMode {
+        FULL_FRAME,    // Search the whole frame every time
+        ROI,           // Search a padded box around the last corners first
+        OPTICAL_FLOW   // Propagate the last corners with pyramidal LK, then refine
+    };
+
+    // Result for one board of a multi-target rig
+    struct TargetDetection {
+        bool found = false;                  // Board located in this frame
+        bool poseValid = false;              // rvec/tvec hold the board pose
+        std::vector<cv::Point2f> corners;    // Refined corners in frame coordinates
+        cv::Mat rvec, tvec;                  // Board pose
+    };
+
     explicit AugmentedReality(int boardWidth = 9, int boardHeight = 6);
     
     /**
-     * @brief Detects chessboard corners and displays results on frame
+     * @brief Detects chessboard corners and draws them on the frame. Once calibrated, boards
+     *        registered with addTarget are searched in the same pass (see getTargetDetections)
      * @param frame Input/output video frame for detection
-     * @return true if chessboard detected, false otherwise
+     * @return true if the primary chessboard was detected, false otherwise
      */
     bool detectChessboard(cv::Mat& frame);
     
@@ -30,16 +54,100 @@ public:
     void saveCalibrationData();
 
     /**
-     * @brief Saves calibration data including frames, corners, and camera parameters
+     * @brief Saves calibration data including frames, corners, and camera parameters;
+     *        files are written in parallel and frames already streamed are not written again
      * @param directory Output directory path for saving data
      */
     void saveAllData(const std::string& directory = "/Users/sundri/Desktop/CS5330/Project4/calibration_data");
+
+    /**
+     * @brief Writes the saved views and current intrinsics as a binary session file
+     * @param path Output session file path
+     * @return true if the session was written
+     */
+    bool saveSession(const std::string& path);
+
+    /**
+     * @brief Appends the views of a saved session and adopts its intrinsics, so calibration
+     *        continues where that session stopped; frames are not reloaded
+     * @param path Session file written by saveSession or saveAllData
+     * @param imageSize Camera resolution; empty to compare with the frames seen so far
+     * @return false if the file is unreadable or was recorded with another board size or resolution
+     */
+    bool resumeSession(const std::string& path, const cv::Size& imageSize = cv::Size());
     
     /**
-     * @brief Performs camera calibration from saved frames
+     * @brief Performs camera calibration from saved frames and waits for the result
      */
     void calibrateCamera();
 
+    /**
+     * @brief Starts calibration on a worker thread; the result replaces the current model at the
+     *        start of the next detectChessboard call, which keeps using the old model until then
+     */
+    void calibrateCameraAsync();
+
+    /**
+     * @brief Recalibrates in the background whenever a view is saved after the first calibration
+     * @param enabled True to refine the model incrementally as views arrive
+     */
+    void setAutoRecalibration(bool enabled) { autoRecalibration = enabled; }
+
+    /**
+     * @brief Saves views automatically, keeping a bounded set chosen for image coverage and pose variety
+     * @param enabled True to score every detection as a keyframe candidate
+     * @param maxViews Largest number of views kept; weaker views are replaced once full
+     */
+    void setAutoKeyframes(bool enabled, size_t maxViews = 30);
+
+    bool isAutoKeyframesEnabled() const { return autoKeyframes; }
+
+    // True while a background calibration is running
+    bool isCalibrating() const { return pendingCalibration.valid(); }
+
+    /**
+     * @brief Uses known intrinsics instead of calibrating from saved frames
+     * @param cameraMatrix 3x3 camera matrix
+     * @param distCoeffs Distortion coefficients in OpenCV order
+     */
+    void setCameraParameters(const cv::Mat& cameraMatrix, const cv::Mat& distCoeffs);
+
+    /**
+     * @brief Loads intrinsics saved for a camera at a resolution by saveIntrinsics
+     * @param path Intrinsics file holding one entry per camera and resolution
+     * @param cameraId Identifier of the camera, e.g. its capture index
+     * @param resolution Frame size the camera delivers
+     * @return false if the file has no entry for this camera and resolution
+     */
+    bool loadIntrinsics(const std::string& path, const std::string& cameraId, const cv::Size& resolution);
+
+    /**
+     * @brief Stores the current intrinsics under the camera and resolution, keeping other entries
+     * @param path Intrinsics file, created if missing
+     * @param cameraId Identifier of the camera, e.g. its capture index
+     * @param resolution Frame size the intrinsics were calibrated at
+     * @return true if the file was written
+     */
+    bool saveIntrinsics(const std::string& path, const std::string& cameraId, const cv::Size& resolution) const;
+
+    /**
+     * @brief Undistorts every frame with precomputed fixed-point maps before detection;
+     *        pose and projection then use zero distortion. Saving calibration views is
+     *        paused while this is active, since undistorted corners would bias calibration
+     * @param enabled True to undistort input frames once the camera is calibrated
+     */
+    void setUndistortInput(bool enabled) { undistortInput = enabled; }
+
+    bool isUndistortInputEnabled() const { return undistortInput; }
+
+    /**
+     * @brief Writes an undistorted copy of a frame using the cached fixed-point maps
+     * @param frame Distorted camera frame
+     * @param undistorted Output frame, same size and type
+     * @return false if the camera is not calibrated yet
+     */
+    bool undistortFrame(const cv::Mat& frame, cv::Mat& undistorted);
+
     /**
      * @brief Estimates camera position and orientation
      * @param rvec Output rotation vector
@@ -48,27 +156,150 @@ public:
      */
     bool computePose(cv::Mat& rvec, cv::Mat& tvec);
 
+    /**
+     * @brief Stands in for detectChessboard and computePose on a frame whose detection is
+     *        skipped: the pose is extrapolated with the constant-velocity model of pose tracking
+     * @param frame Input/output video frame; undistorted like a detected frame, without the gray conversion
+     * @param rvec Output rotation vector
+     * @param tvec Output translation vector
+     * @return false if pose tracking has no recent pose to extrapolate from
+     */
+    bool extrapolatePose(cv::Mat& frame, cv::Mat& rvec, cv::Mat& tvec);
+
+    /**
+     * @brief Ends the frame after detection and pose: publishes its status to the telemetry
+     *        sink once. Call it once per frame that went through detection or extrapolation
+     */
+    void finishFrame();
+
+    /**
+     * @brief Applies a quality stage chosen by a QualityController: coarser detection scale,
+     *        then fewer cornerSubPix iterations. Skipping frames is left to the caller
+     * @param level Quality stage
+     */
+    void setQualityLevel(QualityController::Level level);
+
     /**
      * @brief Renders 3D coordinate axes on frame
      * @param frame Input/output frame to draw on
      * @param rvec Rotation vector for projection
      * @param tvec Translation vector for projection
+     * @param frameUndistorted FrameStatus::undistorted of the frame the pose belongs to
      */
-    void draw3DAxis(cv::Mat& frame, const cv::Mat& rvec, const cv::Mat& tvec);
+    void draw3DAxis(cv::Mat& frame, const cv::Mat& rvec, const cv::Mat& tvec, bool frameUndistorted);
 
     /**
-     * @brief Renders virtual pyramid on detected chessboard
+     * @brief Renders the virtual scene (a pyramid by default) on detected chessboard
      * @param frame Input/output frame to draw on
      * @param rvec Rotation vector for projection
      * @param tvec Translation vector for projection
+     * @param frameUndistorted FrameStatus::undistorted of the frame the pose belongs to; the
+     *        drawing may lag detection by a frame, so the current state cannot be used
      */
-    void drawVirtualObject(cv::Mat& frame, const cv::Mat& rvec, const cv::Mat& tvec);
+    void drawVirtualObject(cv::Mat& frame, const cv::Mat& rvec, const cv::Mat& tvec, bool frameUndistorted);
+
+    /**
+     * @brief Objects drawn by drawVirtualObject, a pyramid at the board origin by default;
+     *        add meshes here to place more content on the board
+     */
+    VirtualScene& getScene() { return scene; }
+
+    /**
+     * @brief Registers an extra board, searched by detectChessboard next to the primary board
+     *        once calibrated; several targets may share a board size, including the primary one
+     * @param boardSize Inner corners per row and column
+     * @return Index of the target; its scene starts as a copy of getScene()
+     */
+    size_t addTarget(const cv::Size& boardSize);
+
+    size_t getTargetCount() const { return targets.size(); }
+
+    // Objects drawn on one target by drawTargets
+    VirtualScene& getTargetScene(size_t index) { return targets[index].scene; }
+
+    // Target results of the last detectChessboard call, one per target
+    const std::vector<TargetDetection>& getTargetDetections() const { return targetDetections; }
+
+    /**
+     * @brief Draws each target's scene at its pose
+     * @param frame Input/output frame to draw on
+     * @param detections Target results of that frame
+     * @param frameUndistorted FrameStatus::undistorted of that frame
+     */
+    void drawTargets(cv::Mat& frame, const std::vector<TargetDetection>& detections, bool frameUndistorted);
+
+    /**
+     * @brief Renders detection status and pose text for a processed frame
+     * @param frame Input/output frame to draw on
+     * @param status Status captured after detectChessboard/computePose for that frame
+     */
+    static void drawOverlay(cv::Mat& frame, const FrameStatus& status);
+
+    /**
+     * @brief Renders the status of the most recently processed frame
+     * @param frame Input/output frame to draw on
+     */
+    void drawOverlay(cv::Mat& frame) const { drawOverlay(frame, frameStatus); }
+
+    /**
+     * @brief Streams every saved view to disk as frame_<view>.png while the session runs
+     * @param writer Writer for the session directory, or nullptr to write frames only in saveAllData
+     */
+    void setSessionWriter(SessionWriter* writer) { sessionWriter = writer; }
+
+    /**
+     * @brief Sends the frame's status record to the sink at every finishFrame
+     * @param sink Telemetry consumer, or nullptr to disable; must outlive its use here
+     */
+    void setTelemetrySink(TelemetrySink* sink) { telemetrySink = sink; }
+
+    /**
+     * @brief Records per-stage timings of detection, pose and drawing into the profiler
+     * @param latencyProfiler Histograms to update, or nullptr to disable; must outlive its use here
+     */
+    void setProfiler(LatencyProfiler* latencyProfiler) { profiler = latencyProfiler; }
     
+    /**
+     * @brief Selects the tracking strategy used after a successful detection
+     * @param mode Tracking mode; any mode falls back to a full-frame search when tracking is lost
+     */
+    void setTrackingMode(TrackingMode mode) { trackingMode = mode; }
+
+    /**
+     * @brief Enables coarse-to-fine search: detect on a downscaled image, refine at full resolution
+     * @param enabled True to search on a scaled-down copy of the frame
+     * @param maxDetectionWidth Longest side of the coarse image while no board is being tracked
+     */
+    void setMultiScaleEnabled(bool enabled, int maxDetectionWidth = 640);
+
+    /**
+     * @brief Stops snapshotting every successful frame; a save request captures the next detection instead.
+     *        Detect, pose and draw then allocate nothing of their own per frame (ar_bench checks this);
+     *        the OpenCV calls they make still allocate internally
+     * @param enabled True to keep only persistent scratch buffers on the per-frame path
+     */
+    void setSteadyStateMode(bool enabled) { steadyStateMode = enabled; }
+
+    /**
+     * @brief Enables pose tracking: computePose warm-starts from a constant-velocity prediction
+     *        and the predicted board position steers the tracking search region
+     * @param enabled True to track the pose between consecutive frames
+     */
+    void setPoseTrackingEnabled(bool enabled);
+
+    /**
+     * @brief Generates the board's 3D world points, one unit per square, in detection order
+     * @param patternSize Inner corners per row and column
+     * @return World points matching the corner order of findChessboardCorners
+     */
+    static std::vector<cv::Point3f> createWorldPoints(const cv::Size& patternSize);
+
     // Getters
-    std::vector<cv::Point2f> getCorners() const;
+    const std::vector<cv::Point2f>& getCorners() const;
     size_t getSavedFramesCount() const;
     const std::vector<std::vector<cv::Point2f>>& getCornerList() const;
     const std::vector<std::vector<cv::Point3f>>& getPointList() const;
+    const FrameStatus& getFrameStatus() const { return frameStatus; }
 
     // Flag
     bool isCalibrated() const { return calibrationDone; }
@@ -87,10 +318,112 @@ private:
     cv::Mat camera_matrix;                             // Camera matrix
     cv::Mat distortion_coefficients;                   // Distortion coefficients
     bool calibrationDone;                              // Flag to track calibration status
-    
-    
-    std::vector<cv::Point3f> createWorldPoints() const; // Generate the 3D world points corresponding to the chessboard pattern
-    std::vector<cv::Point3f> virtualObjectPoints;       // 3D points of the virtual object (e.g., pyramid) defined in world coordinates
+
+    TrackingMode trackingMode;                         // Search strategy after a successful frame
+    float trackingPadding;                             // ROI padding as a fraction of the board extent
+    cv::Mat grayFrame;                                 // Grayscale version of the current frame
+    cv::Mat previousGray;                              // Grayscale version of the previous frame
+    std::vector<cv::Point2f> backtrackedCorners;       // Scratch buffer for the forward-backward flow check
+    std::vector<uchar> trackStatus;                    // Scratch buffer for optical flow status
+    std::vector<float> trackError;                     // Scratch buffer for optical flow error
+
+    bool multiScaleEnabled;                            // Flag for coarse-to-fine detection
+    int maxDetectionWidth;                             // Longest coarse side when the board size is unknown
+    float lastSquareSize;                              // Smallest square size of the last detection in pixels
+    int consecutiveMisses;                             // Frames since the board was last found
+    cv::Mat scaledGray;                                // Downscaled search image
+    bool coarseDetection;                              // Quality stage: search on a smaller image
+    int subPixIterations;                              // Quality stage: cornerSubPix iteration limit
+
+    bool steadyStateMode;                              // Skip the per-frame snapshot, save on request only
+    bool saveRequested;                                // Store the next successful detection (steady-state mode)
+    cv::Size frameSize;                                // Size of the last successful frame
+    std::vector<cv::Point3f> worldPoints;              // Cached 3D world points of the chessboard
+    VirtualScene axisScene;                            // Coordinate axes drawn by draw3DAxis
+    VirtualScene scene;                                // Virtual objects drawn by drawVirtualObject
+
+    FrameStatus frameStatus;                           // Detection and pose state of the latest frame
+    TelemetrySink* telemetrySink;                      // Optional consumer of frame status records
+
+    bool poseTrackingEnabled;                          // Warm-start solvePnP from the predicted pose
+    int poseHistory;                                   // Consecutive tracked poses, capped at 2
+    uint64_t lastPoseFrame;                            // frameIndex of the last tracked pose
+    cv::Vec3d lastRvec, lastTvec;                      // Pose of the last tracked frame
+    cv::Vec3d previousRvec, previousTvec;              // Pose of the frame before that
+    bool hasPrediction;                                // predicted pose/corners are valid for this frame
+    cv::Vec3d predictedRvec, predictedTvec;            // Constant-velocity pose forecast for this frame
+    std::vector<cv::Point2f> predictedCorners;         // Board corners projected with the forecast
+    std::vector<cv::Point2f> reprojectedCorners;       // Scratch buffer for the pose quality check
+
+    LatencyProfiler* profiler;                         // Optional per-stage timing histograms
+
+    // Output of a background calibration run
+    struct CalibrationResult {
+        double rms = 0.0;
+        size_t views = 0;
+        cv::Mat cameraMatrix;
+        cv::Mat distortion;
+    };
+    std::future<CalibrationResult> pendingCalibration; // Running background calibration, if any
+    bool recalibrationPending;                         // New views arrived while a calibration ran
+    bool autoRecalibration;                            // Recalibrate whenever a view is saved
+
+    // Board placement summary used to compare views: center, scale, perspective and in-plane angle
+    typedef cv::Vec<float, 7> ViewDescriptor;
+    bool autoKeyframes;                                // Select calibration views automatically
+    size_t maxKeyframes;                               // Upper bound on the saved views in auto mode
+    std::vector<ViewDescriptor> viewDescriptors;       // One descriptor per saved view
+    std::vector<int> coverageCounts;                   // Saved corners per coverage grid cell
+
+    SessionWriter* sessionWriter;                      // Optional writer that streams saved frames
+    std::vector<bool> framesOnDisk;                    // frame_<view>.png holds this view's image
+    size_t streamedFrameFiles;                         // frame_<i>.png names already streamed; never streamed twice
+
+    bool undistortInput;                               // Remap frames before detection once calibrated
+    bool framesUndistorted;                            // The current frame was remapped
+    cv::Mat undistortMap1, undistortMap2;              // Fixed-point remap tables (CV_16SC2 + CV_16UC1)
+    cv::Size undistortMapSize;                         // Frame size the maps were built for, empty if stale
+    cv::Mat undistortedFrame;                          // Scratch buffer for the remapped frame
+    cv::Mat zeroDistortion;                            // Distortion used for undistorted frames
+
+    // A board of a multi-target rig
+    struct Target {
+        cv::Size boardSize;                            // Inner corners per row and column
+        std::vector<cv::Point3f> worldPoints;          // Board points in detection order
+        VirtualScene scene;                            // Objects drawn on this board
+    };
+    std::vector<Target> targets;                       // Boards searched by searchTargets
+    std::vector<TargetDetection> targetDetections;     // Latest result per target
+    std::unique_ptr<ThreadPool> targetPool;            // Workers for the per-region searches
+    cv::Mat targetSearchGray, targetMask;              // Scratch images for the candidate search
+
+    void remapInput(cv::Mat& frame);                    // Adopt calibration and undistort the frame if enabled
+    void convertFrame(cv::Mat& frame);                  // Adopt calibration, undistort and convert to gray once
+    bool findCorners(const cv::Mat& gray);              // Locate and refine corners, tracking when possible
+    bool findCornersInRegion(const cv::Mat& gray, const cv::Rect& region); // Search a sub-image for the board
+    bool trackCornersOpticalFlow(const cv::Mat& gray);  // Propagate the last corners with optical flow
+    cv::Rect trackingRegion(const cv::Size& frameSize) const; // Padded box around the last and predicted corners
+    bool predictPose();                                 // Forecast this frame's pose from the last two
+    void refineCorners(const cv::Mat& gray);            // Sub-pixel refinement of the current corners
+    double detectionScale(const cv::Size& searchSize) const; // Coarse search scale for a region
+    void updateSquareSize();                            // Measure the board size from the current corners
+    void storeCalibrationView(const cv::Mat& frame);    // Append the last successful detection to the saved views
+    void startCalibration();                            // Launch calibration over a copy of the saved views
+    void applyFinishedCalibration();                    // Adopt the background result once it is ready
+    void prepareUndistortMaps(const cv::Size& size);    // Rebuild the remap tables if size or model changed
+    const cv::Mat& distortionFor(bool undistorted) const { // Distortion for a remapped or raw frame
+        return undistorted ? zeroDistortion : distortion_coefficients;
+    }
+    const cv::Mat& poseDistortion() const {             // Distortion matching the corners of this frame
+        return distortionFor(framesUndistorted);
+    }
+    void considerKeyframe(const cv::Mat& frame);        // Add or swap in the current detection if it is informative
+    void removeCalibrationView(size_t index);           // Drop a saved view and its coverage
+    void trackViewCoverage(const std::vector<cv::Point2f>& viewCorners); // Record a saved view for keyframe selection
+    ViewDescriptor describeView(const std::vector<cv::Point2f>& points) const; // Placement summary of a view
+    int coverageCell(const cv::Point2f& point) const;   // Coverage grid cell of an image point
+    std::vector<cv::Rect> findTargetRegions(const cv::Mat& gray); // Patches dense in edges that may hold a board
+    void searchTargets(cv::Mat& frame, const cv::Rect& primaryBox); // Find the extra targets in the converted frame
 };
 
 #endif // AUGMENTED_REALITY_H
\ No newline at end of file
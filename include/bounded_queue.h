@@ -0,0 +1,107 @@
+/**
+ * Yanting Lai (002955701)
+ * Fall 2024
+ * CS 5330 Project 4
+ * bounded_queue.h
+ */
+
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+/**
+ * Thread-safe FIFO with a fixed capacity used between pipeline stages.
+ * When the queue is full the oldest item is dropped, so a slow consumer
+ * always sees the freshest data instead of building up latency.
+ */
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : capacity(capacity > 0 ? capacity : 1), dropped(0), closed(false) {}
+
+    /**
+     * @brief Adds an item, dropping the oldest one if the queue is full
+     * @param item Item to enqueue
+     * @return false if the queue has been closed
+     */
+    bool push(T item) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (closed) {
+                return false;
+            }
+            if (items.size() >= capacity) {
+                items.pop_front();
+                ++dropped;
+            }
+            items.push_back(std::move(item));
+        }
+        notEmpty.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief Removes the oldest item, waiting until one is available
+     * @param item Output item
+     * @return false once the queue is closed and drained
+     */
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [this] { return !items.empty() || closed; });
+        return takeFront(item);
+    }
+
+    /**
+     * @brief Removes the oldest item, waiting at most the given time
+     * @param item Output item
+     * @param timeout Maximum time to wait
+     * @return true if an item was returned
+     */
+    template <typename Rep, typename Period>
+    bool popFor(T& item, const std::chrono::duration<Rep, Period>& timeout) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait_for(lock, timeout, [this] { return !items.empty() || closed; });
+        return takeFront(item);
+    }
+
+    /**
+     * @brief Wakes all waiting consumers and rejects further pushes
+     */
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+        }
+        notEmpty.notify_all();
+    }
+
+    // Number of items discarded by the drop-oldest policy
+    size_t droppedCount() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return dropped;
+    }
+
+private:
+    bool takeFront(T& item) {
+        if (items.empty()) {
+            return false;
+        }
+        item = std::move(items.front());
+        items.pop_front();
+        return true;
+    }
+
+    const size_t capacity;              // Maximum number of queued items
+    size_t dropped;                     // Items dropped because the queue was full
+    bool closed;                        // Set once the producer is finished
+    std::deque<T> items;                // Queued items, oldest first
+    mutable std::mutex mutex;           // Guards all members above
+    std::condition_variable notEmpty;   // Signalled on push and close
+};
+
+#endif // BOUNDED_QUEUE_H
@@ -0,0 +1,117 @@
+/**
+ * Yanting Lai (002955701)
+ * Fall 2024
+ * CS 5330 Project 4
+ * calibration_session.h
+ */
+
+#ifndef CALIBRATION_SESSION_H
+#define CALIBRATION_SESSION_H
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Binary calibration session file (.bin), laid out so it can be used in place through mmap:
+ *
+ *   SessionHeader                      fixed size, version checked on open
+ *   float world[pointsPerView][3]      board geometry, stored once
+ *   float corners[viewCount][pointsPerView][2]
+ *
+ * Corners of all views are one contiguous array at the end of the file. All values are
+ * little-endian, as written by the x86 and ARM hosts we run on.
+ */
+namespace CalibrationSession {
+
+const char magic[8] = {'A', 'R', 'S', 'E', 'S', 'S', '\0', '\0'};
+const uint32_t currentVersion = 1;
+
+// Header flags
+const uint32_t hasIntrinsics = 1u << 0;   // cameraMatrix/distortion hold a calibrated model
+
+struct SessionHeader {
+    char magic[8];              // "ARSESS"
+    uint32_t version;           // Format version, currentVersion when written
+    uint32_t headerSize;        // sizeof(SessionHeader), lets later versions grow the header
+    int32_t boardWidth;         // Inner corners per row
+    int32_t boardHeight;        // Inner corners per column
+    int32_t imageWidth;         // Frame size the corners were detected in
+    int32_t imageHeight;
+    uint32_t pointsPerView;     // boardWidth * boardHeight
+    uint32_t flags;             // hasIntrinsics
+    uint64_t viewCount;         // Views in the corner array
+    double cameraMatrix[9];     // Row-major 3x3, valid with hasIntrinsics
+    double distortion[8];       // k1 k2 p1 p2 k3 k4 k5 k6, valid with hasIntrinsics
+};
+
+// Everything needed to write a session
+struct SessionData {
+    cv::Size boardSize;
+    cv::Size imageSize;
+    std::vector<cv::Point3f> worldPoints;                 // Shared by every view
+    std::vector<std::vector<cv::Point2f>> corners;        // One set per view
+    cv::Mat cameraMatrix;                                 // Empty if uncalibrated
+    cv::Mat distortion;
+};
+
+/**
+ * @brief Writes a session file; data goes to a temporary file that replaces path on success
+ * @param path Output file path
+ * @param data Board geometry, views and optional intrinsics
+ * @return true if the file was written completely
+ */
+bool write(const std::string& path, const SessionData& data);
+
+/**
+ * Read-only memory mapping of a session file. The corner array is used straight from the
+ * mapping, so opening a session costs a header check regardless of how many views it holds.
+ */
+class MappedSession {
+public:
+    MappedSession();
+    ~MappedSession();
+
+    MappedSession(const MappedSession&) = delete;
+    MappedSession& operator=(const MappedSession&) = delete;
+
+    /**
+     * @brief Maps a session file and validates its header and size
+     * @param path Session file path
+     * @return false if the file is missing, truncated or of another version
+     */
+    bool open(const std::string& path);
+
+    void close();
+
+    bool isOpen() const { return header != nullptr; }
+
+    const SessionHeader& info() const { return *header; }
+    size_t viewCount() const { return static_cast<size_t>(header->viewCount); }
+    cv::Size boardSize() const { return cv::Size(header->boardWidth, header->boardHeight); }
+    cv::Size imageSize() const { return cv::Size(header->imageWidth, header->imageHeight); }
+
+    // Board geometry, pointsPerView entries
+    const cv::Point3f* worldPoints() const { return world; }
+
+    // Corners of one view, pointsPerView entries
+    const cv::Point2f* view(size_t index) const { return corners + index * header->pointsPerView; }
+
+    /**
+     * @brief Copies the stored intrinsics
+     * @return false if the session was saved before calibration
+     */
+    bool intrinsics(cv::Mat& cameraMatrix, cv::Mat& distortion) const;
+
+private:
+    void* mapping;                      // Start of the mapped file
+    size_t mappingSize;                 // Length of the mapping in bytes
+    const SessionHeader* header;        // Header at the start of the mapping
+    const cv::Point3f* world;           // Board geometry inside the mapping
+    const cv::Point2f* corners;         // Corner array inside the mapping
+};
+
+} // namespace CalibrationSession
+
+#endif // CALIBRATION_SESSION_H
@@ -13,6 +13,7 @@
 #include <vector>
 #include <fstream>
 #include <opencv2/opencv.hpp>
+#include "latency_profiler.h"
 
 class CSVUtil {
 public:
@@ -34,6 +35,24 @@ public:
      */
     static bool save3DPoints(const std::string& filename,
                            const std::vector<std::vector<cv::Point3f>>& points);
+
+    /**
+     * @brief Loads corners written by save2DPoints, streaming the file in chunks
+     * @param filename Path to input CSV file
+     * @param points Output corner sets, one per frame
+     * @return true if every row parsed and its frame and point indices continue the rows before it
+     */
+    static bool load2DPoints(const std::string& filename,
+                             std::vector<std::vector<cv::Point2f>>& points);
+
+    /**
+     * @brief Loads world points written by save3DPoints, streaming the file in chunks
+     * @param filename Path to input CSV file
+     * @param points Output point sets, one per frame
+     * @return true if every row parsed and its frame and point indices continue the rows before it
+     */
+    static bool load3DPoints(const std::string& filename,
+                             std::vector<std::vector<cv::Point3f>>& points);
     
     /**
      * @brief Saves calibration summary data to CSV file
@@ -46,6 +65,24 @@ public:
                            int numFrames,
                            const cv::Size& boardSize);
 
+    /**
+     * @brief Saves count, mean, p50/p95/p99 and max of every profiled stage to CSV file
+     * @param filename Path to output CSV file
+     * @param profiler Per-stage latency histograms
+     * @return true if save successful
+     */
+    static bool saveLatencySummary(const std::string& filename,
+                                   const LatencyProfiler& profiler);
+
+    /**
+     * @brief Saves the non-empty histogram buckets of every profiled stage to CSV file
+     * @param filename Path to output CSV file
+     * @param profiler Per-stage latency histograms
+     * @return true if save successful
+     */
+    static bool saveLatencyHistogram(const std::string& filename,
+                                     const LatencyProfiler& profiler);
+
 private:
     /**
      * @brief Creates directory if it doesn't exist
@@ -0,0 +1,52 @@
+/**
+ * Yanting Lai (002955701)
+ * Fall 2024
+ * CS 5330 Project 4
+ * frame_change_gate.h
+ */
+
+#ifndef FRAME_CHANGE_GATE_H
+#define FRAME_CHANGE_GATE_H
+
+#include <opencv2/opencv.hpp>
+
+/**
+ * Tells whether a frame shows the same scene as the last frame that was processed.
+ * Each frame is reduced to a tiny area-averaged gray signature, which averages away
+ * sensor noise; a frame counts as unchanged when its signature stays close to the
+ * reference. The reference only moves when a change is reported, so slow drift
+ * still adds up to a change eventually.
+ */
+class FrameChangeGate {
+public:
+    /**
+     * @brief Creates a gate with no reference; the first frame is always a change
+     * @param meanThreshold Largest mean absolute signature difference, in gray levels
+     * @param cellThreshold Largest difference allowed in any single signature cell
+     */
+    explicit FrameChangeGate(double meanThreshold = 1.0, double cellThreshold = 16.0);
+
+    /**
+     * @brief Compares a frame with the reference
+     * @param frame BGR or gray frame
+     * @return true if the scene is unchanged; otherwise the frame becomes the new reference
+     */
+    bool isUnchanged(const cv::Mat& frame);
+
+    // Forgets the reference so the next frame is processed, e.g. after a state change
+    void invalidate() { reference.release(); }
+
+private:
+    static const int signatureWidth = 32;
+    static const int signatureHeight = 24;
+
+    double meanThreshold;      // Mean difference that counts as a change
+    double cellThreshold;      // Per-cell difference that counts as a change
+    cv::Size referenceSize;    // Frame size of the reference
+    cv::Mat reference;         // Signature of the last processed frame
+    cv::Mat scaled;            // Scratch: downscaled frame
+    cv::Mat signature;         // Scratch: gray signature of the current frame
+    cv::Mat difference;        // Scratch: absolute difference to the reference
+};
+
+#endif // FRAME_CHANGE_GATE_H
@@ -0,0 +1,67 @@
+/**
+ * Yanting Lai (002955701)
+ * Fall 2024
+ * CS 5330 Project 4
+ * harris_detector.h
+ */
+
+#ifndef HARRIS_DETECTOR_H
+#define HARRIS_DETECTOR_H
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+class HarrisDetector {
+public:
+    struct Parameters {
+        int blockSize = 5;        // Neighborhood size of the structure tensor (odd)
+        int apertureSize = 3;     // Sobel aperture (1, 3, 5 or 7)
+        double k = 0.04;          // Harris detector free parameter
+        float threshold = 150;    // Cut in [0, 255] relative to the response range of the frame
+        int gridCols = 8;         // Columns of the selection grid
+        int gridRows = 6;         // Rows of the selection grid
+        int maxPerCell = 0;       // Strongest corners kept per grid cell, 0 keeps all
+        int maxCorners = 0;       // Global cap applied after the per-cell selection, 0 for none
+    };
+
+    /**
+     * @brief Computes the Harris response in parallel row bands
+     * @param gray 8-bit single channel input image
+     * @param params Block size, aperture and k
+     */
+    void computeResponse(const cv::Mat& gray, const Parameters& params);
+
+    /**
+     * @brief Finds local maxima of the Harris response above the threshold
+     * @param gray 8-bit single channel input image
+     * @param params Detector parameters
+     * @param corners Output integer corner locations; row-major unless a selection limit is set
+     */
+    void detect(const cv::Mat& gray, const Parameters& params, std::vector<cv::Point2f>& corners);
+
+    // Raw response of the last computeResponse call
+    const cv::Mat& response() const { return responseMap; }
+
+private:
+    // Candidate maximum with its response and selection cell
+    struct Candidate {
+        float response;
+        cv::Point location;
+        int cell;
+    };
+
+    void selectStrongest(const Parameters& params, const cv::Size& imageSize, int border,
+                         std::vector<cv::Point2f>& corners);
+
+    cv::Mat responseMap;                // CV_32F Harris response
+    cv::Mat neighbourKernel;            // 3x3 neighbourhood without its centre
+    cv::Mat dilated;                    // Largest of the 8 neighbours of each pixel
+    cv::Mat maximaMask;                 // Pixels above all of their 8 neighbours
+    cv::Mat aboveMask;                  // Pixels above the threshold
+    std::vector<cv::Point> locations;   // Scratch buffer for findNonZero
+    std::vector<Candidate> candidates;  // Maxima grouped by cell during selection
+    std::vector<Candidate> grouped;     // Scratch buffer for the cell grouping
+    std::vector<int> cellStart;         // Offset of each cell in grouped
+};
+
+#endif // HARRIS_DETECTOR_H
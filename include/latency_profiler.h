@@ -0,0 +1,112 @@
+/**
+ * Yanting Lai (002955701)
+ * Fall 2024
+ * CS 5330 Project 4
+ * latency_profiler.h
+ */
+
+#ifndef LATENCY_PROFILER_H
+#define LATENCY_PROFILER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Fixed-bucket latency histogram in microseconds.
+ * Buckets are log-linear: exact below 16 us, then 16 buckets per power of two,
+ * so every recorded value is within about 6% of its bucket's lower bound.
+ */
+class LatencyHistogram {
+public:
+    static const int subBuckets = 16;                       // Buckets per power of two
+    static const int bucketCount = subBuckets * 41;         // Covers values up to about 2^44 us
+
+    LatencyHistogram();
+
+    /**
+     * @brief Adds one sample; constant time and allocation free
+     * @param micros Duration in microseconds
+     */
+    void record(uint64_t micros);
+
+    /**
+     * @brief Approximate percentile from the bucket counts
+     * @param percentile Value in [0, 100]
+     * @return Lower bound in microseconds of the bucket holding the percentile, 0 if empty
+     */
+    uint64_t percentile(double percentile) const;
+
+    uint64_t count() const { return total; }
+    uint64_t max() const { return maximum; }
+    double mean() const { return total ? static_cast<double>(sum) / total : 0.0; }
+
+    // Bucket access for export
+    uint64_t bucketSamples(int bucket) const { return counts[bucket]; }
+    static uint64_t bucketLowerBound(int bucket);
+    static int bucketIndex(uint64_t micros);
+
+private:
+    uint64_t counts[bucketCount];    // Samples per bucket
+    uint64_t total;                  // Number of samples
+    uint64_t sum;                    // Sum of all samples in microseconds
+    uint64_t maximum;                // Largest sample in microseconds
+};
+
+/**
+ * One histogram per stage of the AR frame path.
+ * Each stage must be recorded from one thread at a time; read the results
+ * after the recording threads have stopped.
+ */
+class LatencyProfiler {
+public:
+    enum class Stage {
+        CVT_COLOR,         // Grayscale conversion
+        FIND_CORNERS,      // findChessboardCorners or optical flow tracking
+        CORNER_SUBPIX,     // Sub-pixel corner refinement
+        SOLVE_PNP,         // Pose estimation
+        PROJECT_POINTS,    // Projection of virtual object and prediction points
+        DRAW,              // Drawing corners, axes and virtual objects
+        DISPLAY,           // Handing the frame to the window
+        COUNT
+    };
+
+    static const int stageCount = static_cast<int>(Stage::COUNT);
+
+    void record(Stage stage, std::chrono::steady_clock::duration elapsed);
+
+    const LatencyHistogram& histogram(Stage stage) const { return histograms[static_cast<int>(stage)]; }
+    static const char* stageName(Stage stage);
+
+private:
+    LatencyHistogram histograms[stageCount];
+};
+
+/**
+ * Times a scope and records it into a profiler stage; does nothing without a profiler.
+ */
+class ScopedStageTimer {
+public:
+    ScopedStageTimer(LatencyProfiler* profiler, LatencyProfiler::Stage stage)
+        : profiler(profiler), stage(stage) {
+        if (profiler) {
+            start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~ScopedStageTimer() {
+        if (profiler) {
+            profiler->record(stage, std::chrono::steady_clock::now() - start);
+        }
+    }
+
+    ScopedStageTimer(const ScopedStageTimer&) = delete;
+    ScopedStageTimer& operator=(const ScopedStageTimer&) = delete;
+
+private:
+    LatencyProfiler* profiler;
+    LatencyProfiler::Stage stage;
+    std::chrono::steady_clock::time_point start;
+};
+
+#endif // LATENCY_PROFILER_H
@@ -0,0 +1,170 @@
+/**
+ * Yanting Lai (002955701)
+ * Fall 2024
+ * CS 5330 Project 4
+ * pose_stream.h
+ */
+
+#ifndef POSE_STREAM_H
+#define POSE_STREAM_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include "spsc_ring.h"
+#include "telemetry.h"
+
+/**
+ * Board poses streamed to other processes on the same host as fixed-size binary records.
+ *
+ * Shared memory: the publisher creates a POSIX shared memory object holding a SharedPoseRing,
+ * an SpscRing of PoseRecords for one reader process. Publishing never waits; a record that
+ * does not fit because the reader fell behind is counted and dropped.
+ *
+ * Unix socket: every record is also sent as one datagram to a socket path the reader has
+ * bound, without blocking; records are dropped while no reader is bound or its buffer is full.
+ *
+ * Timestamps are steady_clock nanoseconds (CLOCK_MONOTONIC on Linux), which every process
+ * on the host shares, so readers can measure latency against their own clock.
+ */
+namespace PoseStream {
+
+const char magic[8] = {'A', 'R', 'P', 'O', 'S', 'E', '\0', '\0'};
+const uint32_t currentVersion = 1;
+const size_t ringCapacity = 1024;
+
+// Record flags
+const uint32_t poseValid = 1u << 0;       // rvec/tvec hold a pose
+const uint32_t extrapolated = 1u << 1;    // Pose predicted, detection was skipped this frame
+
+struct PoseRecord {
+    uint64_t captureTimeNs;    // When the frame was captured, 0 if unknown
+    uint64_t publishTimeNs;    // When the record was published
+    uint64_t frameIndex;       // Frame counter of the producer
+    double rvec[3];            // Board rotation (Rodrigues vector)
+    double tvec[3];            // Board translation in board squares
+    float quality;             // 1 / (1 + RMS reprojection error in px); 0 without a measured pose
+    uint32_t flags;            // poseValid | extrapolated
+};
+
+// Layout of the shared memory object
+struct SharedPoseRing {
+    char magic[8];                             // "ARPOSE", written last by the publisher
+    uint32_t version;                          // Format version
+    uint32_t recordSize;                       // sizeof(PoseRecord)
+    std::atomic<uint64_t> dropped;             // Records rejected because the ring was full
+    SpscRing<PoseRecord, ringCapacity> ring;   // Records waiting for the reader
+};
+
+// Current steady_clock time in nanoseconds
+inline uint64_t nowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/**
+ * @brief Builds a record from a frame status
+ * @param status Detection and pose state of the frame
+ * @param captureTime When the frame was captured
+ */
+PoseRecord makeRecord(const FrameStatus& status, std::chrono::steady_clock::time_point captureTime);
+
+/**
+ * Producer side; call publish from one thread only.
+ */
+class PosePublisher {
+public:
+    PosePublisher();
+    ~PosePublisher();
+
+    PosePublisher(const PosePublisher&) = delete;
+    PosePublisher& operator=(const PosePublisher&) = delete;
+
+    /**
+     * @brief Creates (or replaces) the shared memory ring
+     * @param name Shared memory object name, e.g. "/ar_pose"
+     * @return false if the object cannot be created or mapped
+     */
+    bool openSharedMemory(const std::string& name);
+
+    /**
+     * @brief Also sends every record to a datagram socket a reader has bound
+     * @param path Socket path, e.g. "/tmp/ar_pose.sock"
+     * @return false if the socket cannot be created
+     */
+    bool openSocket(const std::string& path);
+
+    bool isOpen() const { return shared != nullptr || socketFd >= 0; }
+
+    /**
+     * @brief Stamps the publish time and hands the record to every open transport; never blocks
+     * @param record Record to send
+     */
+    void publish(PoseRecord record);
+
+    uint64_t publishedCount() const { return published; }
+    uint64_t ringDroppedCount() const { return shared ? shared->dropped.load(std::memory_order_relaxed) : 0; }
+    uint64_t socketDroppedCount() const { return socketDropped; }
+
+private:
+    SharedPoseRing* shared;      // Mapped ring, or nullptr
+    std::string sharedName;      // Object unlinked on destruction
+    int socketFd;                // Datagram socket, or -1
+    std::string socketPath;      // Reader's bound address
+    uint64_t published;          // Records passed to publish
+    uint64_t socketDropped;      // Datagrams that could not be sent
+};
+
+/**
+ * Reader side for one of the transports.
+ */
+class PoseSubscriber {
+public:
+    PoseSubscriber();
+    ~PoseSubscriber();
+
+    PoseSubscriber(const PoseSubscriber&) = delete;
+    PoseSubscriber& operator=(const PoseSubscriber&) = delete;
+
+    /**
+     * @brief Maps a ring created by a publisher; start the publisher first
+     * @param name Shared memory object name
+     * @return false if the object is missing or has another format
+     */
+    bool openSharedMemory(const std::string& name);
+
+    /**
+     * @brief Binds the socket path the publisher sends to, replacing a stale socket file
+     * @param path Socket path
+     * @return false if the socket cannot be bound
+     */
+    bool openSocket(const std::string& path);
+
+    /**
+     * @brief Takes the next record without waiting
+     * @param record Output record
+     * @return false if none is available
+     */
+    bool poll(PoseRecord& record);
+
+    /**
+     * @brief Waits for the next record
+     * @param record Output record
+     * @param timeout Longest wait
+     * @return false if none arrived in time
+     */
+    bool receive(PoseRecord& record, std::chrono::milliseconds timeout);
+
+    // Records the publisher dropped because this reader's ring was full
+    uint64_t ringDroppedCount() const { return shared ? shared->dropped.load(std::memory_order_relaxed) : 0; }
+
+private:
+    SharedPoseRing* shared;      // Mapped ring, or nullptr
+    int socketFd;                // Bound datagram socket, or -1
+    std::string socketPath;      // Removed on destruction
+};
+
+} // namespace PoseStream
+
+#endif // POSE_STREAM_H
@@ -0,0 +1,68 @@
+/**
+ * Yanting Lai (002955701)
+ * Fall 2024
+ * CS 5330 Project 4
+ * projection_kernel.h
+ */
+
+#ifndef PROJECTION_KERNEL_H
+#define PROJECTION_KERNEL_H
+
+#include <opencv2/opencv.hpp>
+#include <cstddef>
+#include <vector>
+
+/**
+ * Pinhole projection with OpenCV's distortion model for packed coordinate arrays.
+ * The pose is turned into a rotation matrix once per frame; the per-vertex work runs
+ * with OpenCV universal intrinsics (SSE/AVX/NEON, whatever the build targets).
+ */
+namespace ProjectionKernel {
+
+// Pose, intrinsics and distortion prepared for projection
+struct Model {
+    float r[9];          // Row-major rotation matrix
+    float t[3];          // Translation
+    float fx, fy;        // Focal lengths; skew is ignored, as in cv::projectPoints
+    float cx, cy;        // Principal point
+    float k[12];         // k1 k2 p1 p2 k3 k4 k5 k6 s1 s2 s3 s4, missing ones are zero
+    bool distorted;      // False when the distortion moves no point by more than the tolerance
+};
+
+/**
+ * @brief Prepares a model for projectPoints
+ * @param rvec Rotation (Rodrigues vector)
+ * @param tvec Translation
+ * @param cameraMatrix 3x3 camera matrix
+ * @param distCoeffs Up to 12 coefficients in OpenCV order, or empty; tilt terms are not supported
+ * @param negligiblePixels Distortion whose estimated largest shift inside the image is below
+ *        this many pixels is skipped
+ */
+Model makeModel(const cv::Mat& rvec, const cv::Mat& tvec, const cv::Mat& cameraMatrix,
+                const cv::Mat& distCoeffs, float negligiblePixels = 0.01f);
+
+/**
+ * @brief Projects n points given as separate x, y, z arrays
+ * @param model Prepared pose and camera
+ * @param xs, ys, zs Point coordinates in the board frame
+ * @param n Number of points
+ * @param us, vs Output pixel coordinates
+ * @param depth Output camera-frame depth; points with depth <= 1e-6 have us = vs = cx, cy
+ */
+void projectPoints(const Model& model, const float* xs, const float* ys, const float* zs, size_t n,
+                   float* us, float* vs, float* depth);
+
+/**
+ * @brief Largest pixel distance between this kernel and cv::projectPoints for the given points
+ * @param rvec, tvec, cameraMatrix, distCoeffs Projection as for cv::projectPoints
+ * @param points Points in front of the camera
+ * @param negligiblePixels Passed to makeModel; 0 always runs the full distortion model
+ * @return Maximum difference in pixels
+ */
+double compareWithOpenCV(const cv::Mat& rvec, const cv::Mat& tvec, const cv::Mat& cameraMatrix,
+                         const cv::Mat& distCoeffs, const std::vector<cv::Point3f>& points,
+                         float negligiblePixels = 0.0f);
+
+} // namespace ProjectionKernel
+
+#endif // PROJECTION_KERNEL_H
@@ -0,0 +1,82 @@
+/**
+ * Yanting Lai (002955701)
+ * Fall 2024
+ * CS 5330 Project 4
+ * quality_controller.h
+ */
+
+#ifndef QUALITY_CONTROLLER_H
+#define QUALITY_CONTROLLER_H
+
+#include <chrono>
+#include <cstdint>
+
+/**
+ * Keeps the per-frame cost of detection, pose and drawing inside a frame budget.
+ * The smoothed cost is compared with the budget every frame; a sustained overrun
+ * lowers quality one stage, sustained headroom raises it again. A step up that
+ * cannot be held is retried after twice as long each time, so the level does not
+ * oscillate on a host whose load sits near the budget.
+ */
+class QualityController {
+public:
+    // Quality stages, each including the savings of the ones before it
+    enum class Level {
+        FULL,               // Normal detection and refinement
+        COARSE_DETECTION,   // Search on a smaller downscaled image
+        FAST_REFINEMENT,    // Fewer cornerSubPix iterations
+        ALTERNATE_FRAMES    // Detect every other frame, extrapolate the pose in between
+    };
+
+    /**
+     * @brief Starts at full quality
+     * @param frameBudget Target cost per frame, e.g. the camera frame interval
+     */
+    explicit QualityController(std::chrono::microseconds frameBudget);
+
+    /**
+     * @brief Adds the cost of one frame and adjusts the level
+     * @param cost Time spent on the frame's detection, pose and drawing
+     * @return true if the level changed
+     */
+    bool recordFrame(std::chrono::steady_clock::duration cost);
+
+    /**
+     * @brief Limits how far quality may step down, e.g. when a mode cannot extrapolate poses
+     * @param level Lowest stage the controller may reach; a current level below it is raised
+     */
+    void setLowestLevel(Level level);
+
+    Level level() const { return current; }
+
+    /**
+     * @brief Whether the frame should skip detection and use an extrapolated pose
+     * @param frameNumber Running frame count
+     */
+    bool skipDetection(uint64_t frameNumber) const {
+        return current == Level::ALTERNATE_FRAMES && (frameNumber & 1) != 0;
+    }
+
+    // Smoothed per-frame cost in milliseconds
+    double averageCostMs() const { return smoothedMicros / 1000.0; }
+
+    std::chrono::microseconds budget() const { return frameBudget; }
+
+    static const char* levelName(Level level);
+
+private:
+    void changeLevel(Level level, bool up);
+
+    std::chrono::microseconds frameBudget;   // Target cost per frame
+    Level current;                           // Active quality stage
+    Level lowest;                            // Stage the controller never steps below
+    double smoothedMicros;                   // Exponential average of the frame cost
+    bool hasSample;                          // smoothedMicros holds a value for this level
+    int framesOverBudget;                    // Consecutive frames above the budget
+    int framesWithHeadroom;                  // Consecutive frames well below the budget
+    int framesSinceChange;                   // Frames recorded at the current level
+    int stepUpFrames;                        // Headroom frames required before stepping up
+    bool lastChangeUp;                       // The current level was reached by a step up
+};
+
+#endif // QUALITY_CONTROLLER_H
@@ -0,0 +1,93 @@
+/**
+ * Yanting Lai (002955701)
+ * Fall 2024
+ * CS 5330 Project 4
+ * session_writer.h
+ */
+
+#ifndef SESSION_WRITER_H
+#define SESSION_WRITER_H
+
+#include <opencv2/opencv.hpp>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "thread_pool.h"
+
+/**
+ * Writes session files into one directory on a thread pool. Frames are PNG-encoded on the
+ * workers, so saving views during a session costs the frame loop one queue push, and the
+ * remaining files at exit are written in parallel. Every file reports success or failure.
+ */
+class SessionWriter {
+public:
+    // Counts since the writer was created
+    struct Progress {
+        size_t queued = 0;     // Files handed to the writer
+        size_t written = 0;    // Files written successfully
+        size_t failed = 0;     // Files that could not be written
+    };
+
+    /**
+     * @brief Creates the output directory and starts the workers
+     * @param directory Directory all file names are relative to
+     * @param threadCount Number of encoder threads; 0 uses the hardware concurrency
+     */
+    explicit SessionWriter(const std::string& directory, size_t threadCount = 0);
+
+    // Waits for every queued file
+    ~SessionWriter();
+
+    SessionWriter(const SessionWriter&) = delete;
+    SessionWriter& operator=(const SessionWriter&) = delete;
+
+    /**
+     * @brief Creates a directory and its missing parents with mkdir, without a shell
+     * @param path Directory path
+     * @return true if the directory exists afterwards
+     */
+    static bool createDirectories(const std::string& path);
+
+    const std::string& directory() const { return outputDirectory; }
+
+    /**
+     * @brief Queues a frame for PNG encoding; the pixels are shared, not copied,
+     *        so the caller must not draw into the frame afterwards
+     * @param filename File name inside the output directory
+     * @param frame Image to encode
+     */
+    void writeFrame(const std::string& filename, const cv::Mat& frame);
+
+    /**
+     * @brief Queues an arbitrary file writer, e.g. a CSV export
+     * @param filename File name inside the output directory
+     * @param task Writes the file at the full path it is given; returns false on failure
+     */
+    void writeFile(const std::string& filename, std::function<bool(const std::string&)> task);
+
+    Progress progress() const;
+
+    /**
+     * @brief Blocks until every queued file is finished
+     * @param onProgress Optional callback, called at most every 200 ms while waiting and once at the end
+     * @return Number of files that failed since the writer was created
+     */
+    size_t wait(const std::function<void(const Progress&)>& onProgress = nullptr);
+
+    // Names of the files whose latest write failed
+    std::vector<std::string> failedFiles() const;
+
+private:
+    void finish(const std::string& filename, bool ok);
+
+    std::string outputDirectory;          // Prefix of every written file
+    mutable std::mutex mutex;             // Guards the counters and failures
+    std::condition_variable changed;      // Signalled whenever a file finishes
+    Progress counts;                      // Queued, written and failed files
+    std::vector<std::string> failures;    // Files whose latest write failed, in completion order
+    ThreadPool pool;                      // Declared last so workers finish before the rest is destroyed
+};
+
+#endif // SESSION_WRITER_H
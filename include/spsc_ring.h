@@ -0,0 +1,66 @@
+/**
+ * Yanting Lai (002955701)
+ * Fall 2024
+ * CS 5330 Project 4
+ * spsc_ring.h
+ */
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+
+/**
+ * Lock-free ring buffer for exactly one producer thread and one consumer thread.
+ * push never blocks: when the ring is full the new item is rejected, so a slow
+ * consumer can never stall the producer.
+ */
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "SpscRing capacity must be a power of two");
+
+public:
+    SpscRing() : head(0), tail(0) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    /**
+     * @brief Appends an item (producer thread only)
+     * @param item Item to copy into the ring
+     * @return false if the ring was full and the item was dropped
+     */
+    bool push(const T& item) {
+        const size_t currentTail = tail.load(std::memory_order_relaxed);
+        if (currentTail - head.load(std::memory_order_acquire) >= Capacity) {
+            return false;
+        }
+        slots[currentTail & (Capacity - 1)] = item;
+        tail.store(currentTail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Removes the oldest item (consumer thread only)
+     * @param item Output item
+     * @return false if the ring was empty
+     */
+    bool pop(T& item) {
+        const size_t currentHead = head.load(std::memory_order_relaxed);
+        if (currentHead == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = slots[currentHead & (Capacity - 1)];
+        head.store(currentHead + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    T slots[Capacity];                                   // Item storage, indexed modulo Capacity
+    alignas(64) std::atomic<size_t> head;                // Next slot to read, written by the consumer
+    alignas(64) std::atomic<size_t> tail;                // Next slot to write, written by the producer
+};
+
+#endif // SPSC_RING_H
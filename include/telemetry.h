@@ -0,0 +1,82 @@
+/**
+ * Yanting Lai (002955701)
+ * Fall 2024
+ * CS 5330 Project 4
+ * telemetry.h
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "spsc_ring.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Detection and pose state of one processed frame; plain data so it can be copied through a ring
+struct FrameStatus {
+    uint64_t frameIndex = 0;            // Frames processed by detectChessboard so far
+    bool patternFound = false;          // Chessboard found in this frame
+    bool calibrated = false;            // Camera calibrated when the frame was processed
+    bool poseValid = false;             // rvec/tvec hold the pose for this frame
+    bool poseExtrapolated = false;      // Pose predicted from earlier frames, detection was skipped
+    bool undistorted = false;           // Frame was remapped, so its pose assumes zero distortion
+    float reprojectionError = -1.0f;    // RMS corner reprojection error of the pose in px, -1 if not measured
+    bool lastSuccessAvailable = false;  // An earlier detection can still be saved
+    uint32_t savedFrames = 0;           // Calibration views saved so far
+    double rvec[3] = {0, 0, 0};         // Rotation vector
+    double tvec[3] = {0, 0, 0};         // Translation vector
+};
+
+/**
+ * Receives frame status records from the detection thread without blocking it.
+ * Records go into a lock-free ring; a background thread drains the ring and
+ * prints the newest pose at a fixed rate, optionally logging every record to a file.
+ */
+class TelemetrySink {
+public:
+    /**
+     * @brief Starts the background consumer
+     * @param printInterval Minimum time between console updates
+     * @param logPath Optional file that receives one line per record
+     */
+    explicit TelemetrySink(std::chrono::milliseconds printInterval = std::chrono::milliseconds(200),
+                           const std::string& logPath = "");
+    ~TelemetrySink();
+
+    TelemetrySink(const TelemetrySink&) = delete;
+    TelemetrySink& operator=(const TelemetrySink&) = delete;
+
+    /**
+     * @brief Queues a record; never blocks (single producer thread only)
+     * @param status Record to publish
+     */
+    void publish(const FrameStatus& status);
+
+    // Records rejected because the consumer fell behind
+    uint64_t droppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    void consumerLoop();
+    void drain();
+
+    static const size_t ringCapacity = 256;
+
+    SpscRing<FrameStatus, ringCapacity> ring;   // Records waiting for the consumer
+    std::atomic<uint64_t> dropped;              // Records rejected by a full ring
+    std::chrono::milliseconds printInterval;    // Console update period
+    std::ofstream log;                          // Optional per-record log
+    FrameStatus latestPose;                     // Newest record with a valid pose
+    bool havePose;                              // latestPose has not been printed yet
+    bool stopping;                              // Set by the destructor
+    std::mutex mutex;                           // Guards stopping for the consumer wait
+    std::condition_variable stopRequested;      // Wakes the consumer on shutdown
+    std::thread consumer;                       // Background printing thread
+};
+
+#endif // TELEMETRY_H
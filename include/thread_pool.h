@@ -0,0 +1,101 @@
+/**
+ * Yanting Lai (002955701)
+ * Fall 2024
+ * CS 5330 Project 4
+ * thread_pool.h
+ */
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed set of worker threads consuming a FIFO of tasks.
+ * Results come back through futures, so callers decide the order in which
+ * they are collected regardless of which worker finished first.
+ */
+class ThreadPool {
+public:
+    /**
+     * @brief Starts the worker threads
+     * @param threadCount Number of workers; 0 uses the hardware concurrency
+     */
+    explicit ThreadPool(size_t threadCount = 0) : stopping(false) {
+        if (threadCount == 0) {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+        for (size_t i = 0; i < threadCount; ++i) {
+            workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        taskReady.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief Queues a callable for execution on a worker
+     * @param task Callable taking no arguments
+     * @return Future holding the callable's result or exception
+     */
+    template <typename F>
+    auto submit(F task) -> std::future<decltype(task())> {
+        typedef decltype(task()) Result;
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::move(task));
+        std::future<Result> result = packaged->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push([packaged] { (*packaged)(); });
+        }
+        taskReady.notify_one();
+        return result;
+    }
+
+    size_t size() const { return workers.size(); }
+
+private:
+    void workerLoop() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                taskReady.wait(lock, [this] { return stopping || !tasks.empty(); });
+                // Drain queued work before shutting down
+                if (tasks.empty()) {
+                    return;
+                }
+                task = std::move(tasks.front());
+                tasks.pop();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::thread> workers;          // Worker threads
+    std::queue<std::function<void()>> tasks;   // Pending tasks, oldest first
+    bool stopping;                             // Set by the destructor
+    std::mutex mutex;                          // Guards tasks and stopping
+    std::condition_variable taskReady;         // Signalled on submit and shutdown
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,105 @@
+/**
+ * Yanting Lai (002955701)
+ * Fall 2024
+ * CS 5330 Project 4
+ * virtual_scene.h
+ */
+
+#ifndef VIRTUAL_SCENE_H
+#define VIRTUAL_SCENE_H
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Wireframe objects placed on the board. The vertices of all objects live in one
+ * structure-of-arrays buffer and all edges in one indexed line list, so a frame costs a
+ * single pass over the vertices no matter how many objects there are.
+ */
+class VirtualScene {
+public:
+    // Line between two scene vertices
+    struct Edge {
+        uint32_t from;
+        uint32_t to;
+    };
+
+    // Drawing style and edge range of one object
+    struct Object {
+        std::string name;
+        uint32_t firstEdge;     // Start of the object's edges in the edge list
+        uint32_t edgeCount;
+        cv::Scalar color;
+        int thickness;
+    };
+
+    /**
+     * @brief Adds an object; vertices are placed as offset + scale * vertex in board units
+     * @param name Label of the object
+     * @param vertices Object vertices in its own coordinates
+     * @param edges Lines between vertices, indexed into the object's own vertex list
+     * @param offset Position of the object origin on the board
+     * @param scale Uniform scale applied to the vertices
+     * @param color Line color
+     * @param thickness Line thickness in pixels
+     * @return Index of the new object
+     */
+    size_t addObject(const std::string& name, const std::vector<cv::Point3f>& vertices,
+                     const std::vector<Edge>& edges, const cv::Point3f& offset = cv::Point3f(),
+                     float scale = 1.0f, const cv::Scalar& color = cv::Scalar(0, 255, 255),
+                     int thickness = 2);
+
+    /**
+     * @brief Loads a wireframe from a Wavefront OBJ file; 'v' vertices plus 'l' lines and
+     *        'f' faces (whose outlines become edges) are read, everything else is ignored
+     * @param path OBJ file path
+     * @param offset Position of the object origin on the board
+     * @param scale Uniform scale applied to the vertices
+     * @param color Line color
+     * @param thickness Line thickness in pixels
+     * @return false if the file cannot be read or has no edges
+     */
+    bool loadMesh(const std::string& path, const cv::Point3f& offset = cv::Point3f(),
+                  float scale = 1.0f, const cv::Scalar& color = cv::Scalar(0, 255, 255),
+                  int thickness = 2);
+
+    void clear();
+
+    size_t objectCount() const { return objects.size(); }
+    size_t vertexCount() const { return xs.size(); }
+    size_t edgeCount() const { return edges.size(); }
+    const std::vector<Object>& getObjects() const { return objects; }
+
+    /**
+     * @brief Projects every vertex of the scene in one SIMD pass; distortion that moves no
+     *        point by more than 0.01 px is skipped
+     * @param rvec Board rotation (Rodrigues vector)
+     * @param tvec Board translation
+     * @param cameraMatrix 3x3 camera matrix
+     * @param distCoeffs 4, 5, 8 or more distortion coefficients in OpenCV order, or empty
+     */
+    void project(const cv::Mat& rvec, const cv::Mat& tvec,
+                 const cv::Mat& cameraMatrix, const cv::Mat& distCoeffs);
+
+    /**
+     * @brief Draws the edges of every object from the last projection; edges with an
+     *        endpoint behind the camera are skipped
+     * @param frame Input/output frame to draw on
+     */
+    void draw(cv::Mat& frame) const;
+
+    // Image positions from the last projection, one per vertex
+    const std::vector<float>& projectedX() const { return us; }
+    const std::vector<float>& projectedY() const { return vs; }
+
+private:
+    std::vector<float> xs, ys, zs;    // Board coordinates of all vertices
+    std::vector<float> us, vs;        // Projected pixel coordinates
+    std::vector<float> depths;        // Camera-frame depth, edges need both ends in front
+    std::vector<Edge> edges;          // Line list over all vertices
+    std::vector<Object> objects;      // Edge ranges and styles
+};
+
+#endif // VIRTUAL_SCENE_H
@@ -0,0 +1,628 @@
+/**
+ * Yanting Lai (002955701)
+ * Fall 2024
+ * CS 5330 Project 4
+ * synthetic-pose benchmark for the detection and pose pipeline
+ */
+
+// ar_bench.cpp
+#include "augmented_reality.h"
+#include "latency_profiler.h"
+#include "projection_kernel.h"
+#include "session_writer.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+// Every operator new in the process is counted while countAllocations is set; cv::Mat buffers
+// are included because each one allocates its UMatData header with new
+static std::atomic<bool> countAllocations(false);
+static std::atomic<size_t> allocationCount(0);
+
+static void* countedAllocate(size_t size) {
+    if (countAllocations.load(std::memory_order_relaxed)) {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    void* memory = std::malloc(size != 0 ? size : 1);
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void* operator new(size_t size) { return countedAllocate(size); }
+void* operator new[](size_t size) { return countedAllocate(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return countedAllocate(size);
+    } catch (const std::bad_alloc&) {
+        return nullptr;
+    }
+}
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept { return operator new(size, tag); }
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, size_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, size_t) noexcept { std::free(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+
+struct BenchOptions {
+    std::string imagePath = "extension/data/checkerboard.png";
+    cv::Size patternSize = cv::Size(9, 6);
+    int frames = 2000;
+    double noiseSigma = 3.0;       // Gaussian pixel noise in gray levels
+    double maxBlurSigma = 1.5;     // Blur sigma is drawn from [0, maxBlurSigma]
+    bool sequence = false;         // Smooth trajectory instead of independent random poses
+    bool tracking = false;         // ROI tracking and warm-started pose
+    bool multiScale = false;       // Coarse-to-fine detection
+    unsigned seed = 5330;
+    std::string outputDir;         // Optional directory for CSV results
+    int projectionPoints = 20000;  // Mesh size for the projection kernel check, 0 to skip
+    int allocationFrames = 20;     // Frames measured by the steady-state allocation check, 0 to skip
+};
+
+// Known camera used to render the frames and to run pose estimation
+struct SyntheticCamera {
+    cv::Size imageSize;
+    cv::Mat cameraMatrix;
+    cv::Mat distCoeffs;
+    cv::Mat normalizedRays;        // CV_32FC2 undistorted normalized coordinates of every pixel
+};
+
+struct Pose {
+    cv::Vec3d rvec;
+    cv::Vec3d tvec;
+};
+
+static void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n"
+              << "Options:\n"
+              << "  --image FILE     Board texture (default extension/data/checkerboard.png)\n"
+              << "  --board WxH      Inner corners of the texture (default 9x6)\n"
+              << "  --frames N       Number of generated frames (default 2000)\n"
+              << "  --noise SIGMA    Pixel noise in gray levels (default 3)\n"
+              << "  --blur SIGMA     Maximum Gaussian blur sigma (default 1.5)\n"
+              << "  --sequence       Smooth camera trajectory instead of random poses\n"
+              << "  --tracking       Enable ROI tracking and warm-started pose\n"
+              << "  --multiscale     Enable coarse-to-fine detection\n"
+              << "  --seed N         Random seed (default 5330)\n"
+              << "  --output DIR     Write per-frame results and latency CSV files\n"
+              << "  --projection-points N  Vertices for the projection kernel check (default 20000, 0 skips)\n"
+              << "  --allocation-frames N  Frames for the steady-state allocation check (default 20, 0 skips)\n";
+}
+
+static bool parseOptions(int argc, char** argv, BenchOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--image" && hasValue) {
+            options.imagePath = argv[++i];
+        } else if (arg == "--board" && hasValue) {
+            if (std::sscanf(argv[++i], "%dx%d", &options.patternSize.width,
+                            &options.patternSize.height) != 2) {
+                return false;
+            }
+        } else if (arg == "--frames" && hasValue) {
+            options.frames = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--noise" && hasValue) {
+            options.noiseSigma = std::max(0.0, std::atof(argv[++i]));
+        } else if (arg == "--blur" && hasValue) {
+            options.maxBlurSigma = std::max(0.0, std::atof(argv[++i]));
+        } else if (arg == "--sequence") {
+            options.sequence = true;
+        } else if (arg == "--tracking") {
+            options.tracking = true;
+        } else if (arg == "--multiscale") {
+            options.multiScale = true;
+        } else if (arg == "--seed" && hasValue) {
+            options.seed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--output" && hasValue) {
+            options.outputDir = argv[++i];
+        } else if (arg == "--projection-points" && hasValue) {
+            options.projectionPoints = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--allocation-frames" && hasValue) {
+            options.allocationFrames = std::max(0, std::atoi(argv[++i]));
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+static SyntheticCamera makeCamera() {
+    SyntheticCamera camera;
+    camera.imageSize = cv::Size(640, 480);
+    camera.cameraMatrix = (cv::Mat_<double>(3, 3) << 600, 0, 320,
+                                                     0, 600, 240,
+                                                     0, 0, 1);
+    camera.distCoeffs = (cv::Mat_<double>(8, 1) << -0.12, 0.03, 0.0008, -0.0006, 0, 0, 0, 0);
+
+    // Invert the distortion once for every pixel; each frame then only needs a homography
+    std::vector<cv::Point2f> pixels;
+    pixels.reserve(camera.imageSize.area());
+    for (int y = 0; y < camera.imageSize.height; ++y) {
+        for (int x = 0; x < camera.imageSize.width; ++x) {
+            pixels.push_back(cv::Point2f(static_cast<float>(x), static_cast<float>(y)));
+        }
+    }
+    std::vector<cv::Point2f> rays;
+    cv::undistortPoints(pixels, rays, camera.cameraMatrix, camera.distCoeffs, cv::noArray(), cv::noArray(),
+                        cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 50, 1e-9));
+    camera.normalizedRays = cv::Mat(rays, true).reshape(2, camera.imageSize.height);
+    return camera;
+}
+
+/**
+ * Compares the SIMD projection kernel with cv::projectPoints on a dense random mesh above the
+ * board, for the benchmark camera's distortion and for the zero-distortion fast path.
+ * Returns false if either differs by more than the tolerance.
+ */
+static bool checkProjectionKernel(const SyntheticCamera& camera, int pointCount, unsigned seed) {
+    const double tolerancePx = 0.01;
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> across(0.0f, 8.0f), down(-5.0f, 0.0f), up(-3.0f, 0.0f);
+    std::vector<cv::Point3f> points(pointCount);
+    std::vector<float> xs(pointCount), ys(pointCount), zs(pointCount);
+    for (int i = 0; i < pointCount; ++i) {
+        points[i] = cv::Point3f(across(rng), down(rng), up(rng));
+        xs[i] = points[i].x;
+        ys[i] = points[i].y;
+        zs[i] = points[i].z;
+    }
+    cv::Mat rvec = (cv::Mat_<double>(3, 1) << 0.3, -0.2, 0.1);
+    cv::Mat tvec = (cv::Mat_<double>(3, 1) << -4.0, 2.5, 18.0);
+    cv::Mat noDistortion = cv::Mat::zeros(8, 1, CV_64F);
+
+    double distortedError = ProjectionKernel::compareWithOpenCV(rvec, tvec, camera.cameraMatrix,
+                                                                camera.distCoeffs, points);
+    double fastPathError = ProjectionKernel::compareWithOpenCV(rvec, tvec, camera.cameraMatrix,
+                                                               noDistortion, points, 0.01f);
+
+    // Per-call cost including model setup, as paid once per rendered frame
+    const int repeats = 50;
+    std::vector<float> us(pointCount), vs(pointCount), depth(pointCount);
+    std::vector<cv::Point2f> projected;
+    Clock::time_point start = Clock::now();
+    for (int r = 0; r < repeats; ++r) {
+        ProjectionKernel::Model model = ProjectionKernel::makeModel(rvec, tvec, camera.cameraMatrix,
+                                                                    camera.distCoeffs);
+        ProjectionKernel::projectPoints(model, xs.data(), ys.data(), zs.data(), xs.size(),
+                                        us.data(), vs.data(), depth.data());
+    }
+    double kernelUs = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / repeats;
+    start = Clock::now();
+    for (int r = 0; r < repeats; ++r) {
+        cv::projectPoints(points, rvec, tvec, camera.cameraMatrix, camera.distCoeffs, projected);
+    }
+    double openCVUs = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / repeats;
+
+    bool passed = distortedError <= tolerancePx && fastPathError <= tolerancePx;
+    std::cout << "\nProjection kernel (" << pointCount << " vertices):" << std::endl;
+    std::cout << "- Max difference to cv::projectPoints: " << distortedError << " px distorted, "
+              << fastPathError << " px without distortion (tolerance " << tolerancePx << " px) - "
+              << (passed ? "OK" : "FAILED") << std::endl;
+    std::cout << "- Time per call: " << kernelUs << " us kernel, " << openCVUs << " us cv::projectPoints ("
+              << openCVUs / std::max(kernelUs, 1e-3) << "x)" << std::endl;
+    return passed;
+}
+
+/**
+ * Counts heap allocations per frame on the steady-state detect -> pose -> draw path, once through
+ * AugmentedReality and once through the bare OpenCV calls it makes, on the same frame. OpenCV
+ * allocates inside findChessboardCorners, solvePnP and friends, so only allocations beyond the
+ * bare calls belong to AugmentedReality; the check fails if there are any in every measured frame.
+ * The bare calls mirror the full-frame path without tracking, multi-scale search or undistortion.
+ */
+static bool checkSteadyStateAllocations(const cv::Mat& source, const cv::Size& patternSize,
+                                        const SyntheticCamera& camera, int frames) {
+    AugmentedReality ar(patternSize.width, patternSize.height);
+    ar.setSteadyStateMode(true);
+    ar.setCameraParameters(camera.cameraMatrix, camera.distCoeffs);
+
+    // Persistent buffers for the bare calls, as AugmentedReality keeps its own
+    const std::vector<cv::Point3f> worldPoints = AugmentedReality::createWorldPoints(patternSize);
+    const int flags = cv::CALIB_CB_ADAPTIVE_THRESH + cv::CALIB_CB_NORMALIZE_IMAGE + cv::CALIB_CB_FAST_CHECK;
+    cv::Mat frame, gray, rvec, tvec, bareRvec, bareTvec;
+    std::vector<cv::Point2f> corners, reprojected;
+    cv::Matx33d rotation;
+
+    // Run OpenCV sequentially so worker threads do not add to either count
+    const int threads = cv::getNumThreads();
+    cv::setNumThreads(0);
+
+    // The first frames size the scratch buffers of both paths
+    const int warmupFrames = 3;
+    size_t fewestPipeline = std::numeric_limits<size_t>::max();
+    size_t mostBare = 0;
+    bool detected = true;
+    for (int i = 0; i < warmupFrames + frames && detected; ++i) {
+        source.copyTo(frame);
+        allocationCount = 0;
+        countAllocations = true;
+        detected = ar.detectChessboard(frame) && ar.computePose(rvec, tvec);
+        if (detected) {
+            ar.drawVirtualObject(frame, rvec, tvec, false);
+            ar.draw3DAxis(frame, rvec, tvec, false);
+        }
+        countAllocations = false;
+        const size_t pipeline = allocationCount;
+
+        source.copyTo(frame);
+        allocationCount = 0;
+        countAllocations = true;
+        cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+        if (cv::findChessboardCorners(gray, patternSize, corners, flags)) {
+            cv::cornerSubPix(gray, corners, cv::Size(11, 11), cv::Size(-1, -1),
+                             cv::TermCriteria(cv::TermCriteria::EPS + cv::TermCriteria::COUNT, 30, 0.1));
+            cv::drawChessboardCorners(frame, patternSize, corners, true);
+            cv::solvePnP(worldPoints, corners, camera.cameraMatrix, camera.distCoeffs,
+                         bareRvec, bareTvec, false, cv::SOLVEPNP_ITERATIVE);
+            cv::projectPoints(worldPoints, bareRvec, bareTvec, camera.cameraMatrix, camera.distCoeffs, reprojected);
+            cv::norm(corners, reprojected, cv::NORM_L2);
+            // One rotation per drawn scene; cv::line with 8-connected lines does not allocate
+            cv::Rodrigues(bareRvec, rotation);
+            cv::Rodrigues(bareRvec, rotation);
+        }
+        countAllocations = false;
+        const size_t bare = allocationCount;
+
+        if (i >= warmupFrames) {
+            fewestPipeline = std::min(fewestPipeline, pipeline);
+            mostBare = std::max(mostBare, bare);
+        }
+    }
+    cv::setNumThreads(threads);
+
+    std::cout << "\nSteady-state allocations:" << std::endl;
+    if (!detected) {
+        std::cout << "- Board not detected in the check frame, allocations not measured: FAILED" << std::endl;
+        return false;
+    }
+    const size_t owned = fewestPipeline > mostBare ? fewestPipeline - mostBare : 0;
+    std::cout << "- Detect + pose + draw: at least " << fewestPipeline << " per frame, bare OpenCV calls at most "
+              << mostBare << " over " << frames << " frames" << std::endl;
+    std::cout << "- Owned by AugmentedReality: " << owned << " per frame: "
+              << (owned == 0 ? "passed" : "FAILED") << std::endl;
+    return owned == 0;
+}
+
+static cv::Matx33d eulerRotation(double rollDeg, double pitchDeg, double yawDeg) {
+    const double toRad = CV_PI / 180.0;
+    double r = rollDeg * toRad, p = pitchDeg * toRad, y = yawDeg * toRad;
+    cv::Matx33d rx(1, 0, 0,
+                   0, std::cos(p), -std::sin(p),
+                   0, std::sin(p), std::cos(p));
+    cv::Matx33d ry(std::cos(y), 0, std::sin(y),
+                   0, 1, 0,
+                   -std::sin(y), 0, std::cos(y));
+    cv::Matx33d rz(std::cos(r), -std::sin(r), 0,
+                   std::sin(r), std::cos(r), 0,
+                   0, 0, 1);
+    return rz * ry * rx;
+}
+
+// Board pose with the board center at centerInCamera, facing the camera and tilted by the given angles
+static Pose makePose(double rollDeg, double pitchDeg, double yawDeg,
+                     const cv::Vec3d& centerInCamera, const cv::Size& patternSize) {
+    // World Y points up the board (points are (j, -i, 0)), camera y points down the image
+    const cv::Matx33d facingCamera(1, 0, 0,
+                                   0, -1, 0,
+                                   0, 0, -1);
+    cv::Matx33d rotation = eulerRotation(rollDeg, pitchDeg, yawDeg) * facingCamera;
+    cv::Vec3d boardCenter((patternSize.width - 1) / 2.0, -(patternSize.height - 1) / 2.0, 0.0);
+
+    Pose pose;
+    cv::Rodrigues(rotation, pose.rvec);
+    pose.tvec = centerInCamera - rotation * boardCenter;
+    return pose;
+}
+
+// True if the whole board, including its outer squares, projects inside the image
+static bool boardVisible(const Pose& pose, const SyntheticCamera& camera, const cv::Size& patternSize) {
+    std::vector<cv::Point3f> outline = {
+        cv::Point3f(-1, 1, 0),
+        cv::Point3f(static_cast<float>(patternSize.width), 1, 0),
+        cv::Point3f(static_cast<float>(patternSize.width), static_cast<float>(-patternSize.height), 0),
+        cv::Point3f(-1, static_cast<float>(-patternSize.height), 0)
+    };
+    std::vector<cv::Point2f> projected;
+    cv::projectPoints(outline, pose.rvec, pose.tvec, camera.cameraMatrix, camera.distCoeffs, projected);
+    const float margin = 8.0f;
+    for (const auto& point : projected) {
+        if (point.x < margin || point.y < margin ||
+            point.x > camera.imageSize.width - margin || point.y > camera.imageSize.height - margin) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static Pose generatePose(int frame, const BenchOptions& options, const SyntheticCamera& camera,
+                         std::mt19937& rng) {
+    const cv::Size& patternSize = options.patternSize;
+    if (options.sequence) {
+        // Smooth motion with incommensurate periods so the path does not repeat quickly
+        const double k = 2.0 * CV_PI * frame;
+        double z = 14.0 + 3.0 * std::sin(k / 347.0);
+        cv::Vec3d center(0.12 * z * std::sin(k / 211.0), 0.1 * z * std::sin(k / 163.0 + 1.0), z);
+        return makePose(20.0 * std::sin(k / 293.0), 30.0 * std::sin(k / 181.0),
+                        30.0 * std::sin(k / 239.0 + 0.5), center, patternSize);
+    }
+
+    std::uniform_real_distribution<double> tilt(-35.0, 35.0);
+    std::uniform_real_distribution<double> roll(-25.0, 25.0);
+    std::uniform_real_distribution<double> depth(10.0, 18.0);
+    std::uniform_real_distribution<double> offset(-0.15, 0.15);
+    Pose pose;
+    for (int attempt = 0; attempt < 100; ++attempt) {
+        double z = depth(rng);
+        cv::Vec3d center(offset(rng) * z, offset(rng) * z, z);
+        pose = makePose(roll(rng), tilt(rng), tilt(rng), center, patternSize);
+        if (boardVisible(pose, camera, patternSize)) {
+            break;
+        }
+    }
+    return pose;
+}
+
+// Warps the board texture into the camera, then blurs and adds noise
+static void renderFrame(const cv::Mat& texture, const cv::Matx33d& worldToTexture,
+                        const SyntheticCamera& camera, const Pose& pose,
+                        double blurSigma, double noiseSigma, cv::RNG& noiseRng,
+                        cv::Mat& textureMap, cv::Mat& noise, cv::Mat& gray, cv::Mat& frame) {
+    // Board plane z = 0: normalized ray ~ [r1 r2 t] * (X, Y, 1)
+    cv::Matx33d rotation;
+    cv::Rodrigues(pose.rvec, rotation);
+    cv::Matx33d plane(rotation(0, 0), rotation(0, 1), pose.tvec[0],
+                      rotation(1, 0), rotation(1, 1), pose.tvec[1],
+                      rotation(2, 0), rotation(2, 1), pose.tvec[2]);
+    cv::Matx33d rayToTexture = worldToTexture * plane.inv();
+
+    cv::perspectiveTransform(camera.normalizedRays, textureMap, cv::Mat(rayToTexture));
+    cv::remap(texture, gray, textureMap, cv::noArray(), cv::INTER_LINEAR,
+              cv::BORDER_CONSTANT, cv::Scalar(255));
+
+    if (blurSigma > 0.05) {
+        cv::GaussianBlur(gray, gray, cv::Size(0, 0), blurSigma);
+    }
+    if (noiseSigma > 0.0) {
+        gray.convertTo(noise, CV_32F);
+        cv::Mat sample(noise.size(), CV_32F);
+        noiseRng.fill(sample, cv::RNG::NORMAL, 0.0, noiseSigma);
+        noise += sample;
+        noise.convertTo(gray, CV_8U);
+    }
+    cv::cvtColor(gray, frame, cv::COLOR_GRAY2BGR);
+}
+
+static double rotationErrorDegrees(const cv::Mat& rvec, const cv::Vec3d& truth) {
+    cv::Matx33d estimated, expected;
+    cv::Rodrigues(rvec, estimated);
+    cv::Rodrigues(truth, expected);
+    cv::Vec3d difference;
+    cv::Rodrigues(estimated.t() * expected, difference);
+    return cv::norm(difference) * 180.0 / CV_PI;
+}
+
+static double percentileOf(std::vector<double> values, double percentile) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    size_t rank = static_cast<size_t>(std::ceil(percentile / 100.0 * values.size()));
+    rank = std::min(values.size(), std::max<size_t>(1, rank)) - 1;
+    std::nth_element(values.begin(), values.begin() + rank, values.end());
+    return values[rank];
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return -1;
+    }
+
+    cv::Mat source = cv::imread(options.imagePath, cv::IMREAD_GRAYSCALE);
+    if (source.empty()) {
+        std::cerr << "Error: Could not load image: " << options.imagePath << std::endl;
+        return -1;
+    }
+
+    // Shrink the texture towards the rendered square size to limit aliasing in remap
+    const double textureScale = std::min(1.0, 640.0 / std::max(source.cols, source.rows));
+    cv::Mat texture;
+    cv::resize(source, texture, cv::Size(), textureScale, textureScale, cv::INTER_AREA);
+
+    // Ground truth mapping from board world coordinates to texture pixels
+    std::vector<cv::Point2f> textureCorners;
+    if (!cv::findChessboardCorners(texture, options.patternSize, textureCorners,
+                                   cv::CALIB_CB_ADAPTIVE_THRESH + cv::CALIB_CB_NORMALIZE_IMAGE)) {
+        std::cerr << "Error: No " << options.patternSize.width << "x" << options.patternSize.height
+                  << " chessboard in " << options.imagePath << std::endl;
+        return -1;
+    }
+    cv::cornerSubPix(texture, textureCorners, cv::Size(11, 11), cv::Size(-1, -1),
+                     cv::TermCriteria(cv::TermCriteria::EPS + cv::TermCriteria::COUNT, 50, 0.001));
+    const std::vector<cv::Point3f> worldPoints = AugmentedReality::createWorldPoints(options.patternSize);
+    std::vector<cv::Point2f> worldPlane;
+    for (const auto& point : worldPoints) {
+        worldPlane.push_back(cv::Point2f(point.x, point.y));
+    }
+    cv::Matx33d worldToTexture = cv::findHomography(worldPlane, textureCorners);
+
+    SyntheticCamera camera = makeCamera();
+
+    AugmentedReality ar(options.patternSize.width, options.patternSize.height);
+    LatencyProfiler profiler;
+    ar.setProfiler(&profiler);
+    ar.setSteadyStateMode(true);
+    ar.setCameraParameters(camera.cameraMatrix, camera.distCoeffs);
+    if (options.tracking) {
+        ar.setTrackingMode(AugmentedReality::TrackingMode::ROI);
+        ar.setPoseTrackingEnabled(true);
+    }
+    ar.setMultiScaleEnabled(options.multiScale);
+
+    std::ofstream frameLog;
+    if (!options.outputDir.empty()) {
+        SessionWriter::createDirectories(options.outputDir);
+        std::string path = options.outputDir + "/bench_frames.csv";
+        frameLog.open(path.c_str());
+        if (!frameLog.is_open()) {
+            std::cerr << "Failed to open file: " << path << std::endl;
+            return -1;
+        }
+        frameLog << "Frame,Detected,Flipped,CornerRMS_px,RotationError_deg,TranslationError,PipelineMs\n";
+    }
+
+    std::cout << "Running " << options.frames << (options.sequence ? " sequential" : " random")
+              << " synthetic frames (" << camera.imageSize.width << "x" << camera.imageSize.height
+              << ", noise " << options.noiseSigma << ", blur <= " << options.maxBlurSigma << ")" << std::endl;
+
+    std::mt19937 rng(options.seed);
+    std::uniform_real_distribution<double> blur(0.0, options.maxBlurSigma);
+    cv::RNG noiseRng(options.seed);
+    cv::Mat textureMap, noise, gray, frame, rvec, tvec;
+    std::vector<cv::Point2f> truthCorners;
+
+    int detected = 0;
+    int posed = 0;
+    int flipped = 0;
+    double cornerSquaredSum = 0.0;
+    size_t cornerCount = 0;
+    std::vector<double> rotationErrors, translationErrors, pipelineMs;
+    rotationErrors.reserve(options.frames);
+    translationErrors.reserve(options.frames);
+    pipelineMs.reserve(options.frames);
+    double generationSec = 0.0;
+
+    for (int i = 0; i < options.frames; ++i) {
+        Clock::time_point generateStart = Clock::now();
+        Pose truth = generatePose(i, options, camera, rng);
+        renderFrame(texture, worldToTexture, camera, truth, blur(rng), options.noiseSigma,
+                    noiseRng, textureMap, noise, gray, frame);
+        cv::projectPoints(worldPoints, truth.rvec, truth.tvec, camera.cameraMatrix,
+                          camera.distCoeffs, truthCorners);
+        generationSec += std::chrono::duration<double>(Clock::now() - generateStart).count();
+
+        // Timed section: the same detect -> pose chain as the live loop
+        Clock::time_point start = Clock::now();
+        bool found = ar.detectChessboard(frame);
+        bool poseFound = found && ar.computePose(rvec, tvec);
+        double elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        pipelineMs.push_back(elapsedMs);
+
+        double frameRms = 0.0, rotationError = 0.0, translationError = 0.0;
+        bool frameFlipped = false;
+        if (found) {
+            ++detected;
+            const std::vector<cv::Point2f>& corners = ar.getCorners();
+
+            // The detector may report the board rotated by 180 degrees; compare both orders
+            double direct = 0.0, reversed = 0.0;
+            for (size_t j = 0; j < corners.size(); ++j) {
+                cv::Point2f d = corners[j] - truthCorners[j];
+                cv::Point2f r = corners[j] - truthCorners[corners.size() - 1 - j];
+                direct += d.dot(d);
+                reversed += r.dot(r);
+            }
+            frameFlipped = reversed < direct;
+            double squared = std::min(direct, reversed);
+            cornerSquaredSum += squared;
+            cornerCount += corners.size();
+            frameRms = std::sqrt(squared / corners.size());
+
+            if (frameFlipped) {
+                ++flipped;
+            } else if (poseFound) {
+                ++posed;
+                rotationError = rotationErrorDegrees(rvec, truth.rvec);
+                translationError = cv::norm(cv::Vec3d(tvec.at<double>(0), tvec.at<double>(1),
+                                                      tvec.at<double>(2)) - truth.tvec);
+                rotationErrors.push_back(rotationError);
+                translationErrors.push_back(translationError);
+            }
+        }
+
+        if (frameLog.is_open()) {
+            frameLog << i << "," << found << "," << frameFlipped << "," << frameRms << ","
+                     << rotationError << "," << translationError << "," << elapsedMs << "\n";
+        }
+    }
+
+    double pipelineSec = 0.0;
+    for (double ms : pipelineMs) {
+        pipelineSec += ms / 1000.0;
+    }
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "\nThroughput:" << std::endl;
+    std::cout << "- Detect + pose: " << options.frames / pipelineSec << " frames/s ("
+              << 1000.0 * pipelineSec / options.frames << " ms/frame, p50 "
+              << percentileOf(pipelineMs, 50) << " ms, p99 " << percentileOf(pipelineMs, 99) << " ms)" << std::endl;
+    std::cout << "- Frame generation: " << 1000.0 * generationSec / options.frames << " ms/frame (not timed above)" << std::endl;
+
+    std::cout << "\nAccuracy:" << std::endl;
+    std::cout << "- Detected: " << detected << "/" << options.frames
+              << " (" << 100.0 * detected / options.frames << "%), reversed order: " << flipped << std::endl;
+    std::cout << "- Corner RMS error: "
+              << (cornerCount ? std::sqrt(cornerSquaredSum / cornerCount) : 0.0) << " px" << std::endl;
+    std::cout << "- Rotation error: median " << percentileOf(rotationErrors, 50) << " deg, p95 "
+              << percentileOf(rotationErrors, 95) << " deg over " << posed << " poses" << std::endl;
+    std::cout << "- Translation error: median " << percentileOf(translationErrors, 50) << ", p95 "
+              << percentileOf(translationErrors, 95) << " squares" << std::endl;
+
+    std::cout << "\nPer-stage latency (us):" << std::endl;
+    std::cout << std::left << std::setw(24) << "Stage" << std::right << std::setw(10) << "Count"
+              << std::setw(10) << "Mean" << std::setw(10) << "p50" << std::setw(10) << "p95"
+              << std::setw(10) << "p99" << std::setw(10) << "Max" << std::endl;
+    std::cout << std::setprecision(1);
+    for (int i = 0; i < LatencyProfiler::stageCount; ++i) {
+        LatencyProfiler::Stage stage = static_cast<LatencyProfiler::Stage>(i);
+        const LatencyHistogram& histogram = profiler.histogram(stage);
+        if (histogram.count() == 0) {
+            continue;
+        }
+        std::cout << std::left << std::setw(24) << LatencyProfiler::stageName(stage) << std::right
+                  << std::setw(10) << histogram.count() << std::setw(10) << histogram.mean()
+                  << std::setw(10) << histogram.percentile(50) << std::setw(10) << histogram.percentile(95)
+                  << std::setw(10) << histogram.percentile(99) << std::setw(10) << histogram.max() << std::endl;
+    }
+    std::cout.unsetf(std::ios::floatfield);
+
+    bool projectionPassed = true;
+    if (options.projectionPoints > 0) {
+        std::cout << std::fixed << std::setprecision(4);
+        projectionPassed = checkProjectionKernel(camera, options.projectionPoints, options.seed);
+        std::cout.unsetf(std::ios::floatfield);
+    }
+
+    bool allocationsPassed = true;
+    if (options.allocationFrames > 0) {
+        // A clean, slightly tilted view that is detected on every repetition
+        Pose steadyPose = makePose(5.0, 15.0, -10.0, cv::Vec3d(0.0, 0.0, 14.0), options.patternSize);
+        renderFrame(texture, worldToTexture, camera, steadyPose, 0.0, 0.0, noiseRng,
+                    textureMap, noise, gray, frame);
+        allocationsPassed = checkSteadyStateAllocations(frame, options.patternSize, camera,
+                                                        options.allocationFrames);
+    }
+
+    if (!options.outputDir.empty()) {
+        CSVUtil::saveLatencySummary(options.outputDir + "/bench_latency.csv", profiler);
+        std::cout << "\nSaved results to " << options.outputDir << std::endl;
+    }
+    return (projectionPassed && allocationsPassed) ? 0 : 1;
+}
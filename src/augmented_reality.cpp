@@ -7,16 +7,50 @@
 
 // augmented_reality.cpp
 #include "augmented_reality.h"
+#include "calibration_session.h"
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <memory>
 
 AugmentedReality::AugmentedReality(int boardWidth, int boardHeight)
     : patternSize(boardWidth, boardHeight), 
       lastFrameSuccess(false),
-      calibrationDone(false) {
+      calibrationDone(false),
+      trackingMode(TrackingMode::FULL_FRAME),
+      trackingPadding(0.35f),
+      multiScaleEnabled(false),
+      maxDetectionWidth(640),
+      lastSquareSize(0.0f),
+      consecutiveMisses(0),
+      coarseDetection(false),
+      subPixIterations(30),
+      steadyStateMode(false),
+      saveRequested(false),
+      worldPoints(createWorldPoints(patternSize)),
+      telemetrySink(nullptr),
+      poseTrackingEnabled(false),
+      poseHistory(0),
+      lastPoseFrame(0),
+      hasPrediction(false),
+      profiler(nullptr),
+      recalibrationPending(false),
+      autoRecalibration(false),
+      autoKeyframes(false),
+      maxKeyframes(30),
+      sessionWriter(nullptr),
+      streamedFrameFiles(0),
+      undistortInput(false),
+      framesUndistorted(false),
+      zeroDistortion(cv::Mat::zeros(8, 1, CV_64F)) {
 
       float scaleFactor = 2.0;
           
     // Define the 3D points for a pyramid virtual object in world coordinates
-    virtualObjectPoints = {
+    std::vector<cv::Point3f> virtualObjectPoints = {
         cv::Point3f(0, 0, 0)  * scaleFactor,        // Center of the base
         cv::Point3f(-0.5, -0.5, 0)  * scaleFactor,  // Bottom-left of the base
         cv::Point3f(0.5, -0.5, 0)  * scaleFactor,   // Bottom-right of the base
@@ -24,92 +58,364 @@ AugmentedReality::AugmentedReality(int boardWidth, int boardHeight)
         cv::Point3f(-0.5, 0.5, 0)  * scaleFactor,   // Top-left of the base
         cv::Point3f(0, 0, 1) * scaleFactor          // The apex of the pyramid
     };
+
+    // Base edges in blue, lines to the apex in green
+    scene.addObject("pyramid base", virtualObjectPoints, {{0, 1}, {1, 2}, {2, 3}, {3, 4}, {4, 0}},
+                    cv::Point3f(), 1.0f, cv::Scalar(255, 0, 0), 2);
+    scene.addObject("pyramid sides", virtualObjectPoints, {{0, 5}, {1, 5}, {2, 5}, {3, 5}, {4, 5}},
+                    cv::Point3f(), 1.0f, cv::Scalar(0, 255, 0), 2);
+
+    // Each axis is 3 units in length
+    std::vector<cv::Point3f> axisPoints = {
+        cv::Point3f(0, 0, 0),   // Origin
+        cv::Point3f(3, 0, 0),   // X-axis endpoint
+        cv::Point3f(0, 3, 0),   // Y-axis endpoint
+        cv::Point3f(0, 0, -3)   // Z-axis endpoint (negative for upward in image)
+    };
+    axisScene.addObject("x axis", axisPoints, {{0, 1}}, cv::Point3f(), 1.0f, cv::Scalar(0, 0, 255), 3);
+    axisScene.addObject("y axis", axisPoints, {{0, 2}}, cv::Point3f(), 1.0f, cv::Scalar(0, 255, 0), 3);
+    axisScene.addObject("z axis", axisPoints, {{0, 3}}, cv::Point3f(), 1.0f, cv::Scalar(255, 0, 0), 3);
+}
+
+void AugmentedReality::remapInput(cv::Mat& frame) {
+    // Swap in a finished background calibration at a frame boundary
+    applyFinishedCalibration();
+
+    // Work on the undistorted image; the remap tables are built once per model and size
+    framesUndistorted = undistortInput && calibrationDone && undistortFrame(frame, undistortedFrame);
+    if (framesUndistorted) {
+        undistortedFrame.copyTo(frame);
+    }
+}
+
+void AugmentedReality::convertFrame(cv::Mat& frame) {
+    remapInput(frame);
+
+    ScopedStageTimer timer(profiler, LatencyProfiler::Stage::CVT_COLOR);
+    cv::cvtColor(frame, grayFrame, cv::COLOR_BGR2GRAY);
 }
 
 bool AugmentedReality::detectChessboard(cv::Mat& frame) {
-    cv::Mat gray;
-    cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+    convertFrame(frame);
+
+    // Forecast where the board should be from the recent poses
+    hasPrediction = predictPose();
     
-    // Find chessboard corners
-    bool patternFound = cv::findChessboardCorners(gray, patternSize, corners,
-                         cv::CALIB_CB_ADAPTIVE_THRESH +
-                         cv::CALIB_CB_NORMALIZE_IMAGE +
-                         cv::CALIB_CB_FAST_CHECK);
+    // Find and refine chessboard corners, tracking from the last frame when possible
+    bool patternFound = findCorners(grayFrame);
     
     if(patternFound) {
-        // Refine corner locations
-        cv::cornerSubPix(gray, corners, cv::Size(11,11), cv::Size(-1,-1),
-                        cv::TermCriteria(cv::TermCriteria::EPS + 
-                                       cv::TermCriteria::COUNT, 30, 0.1));
-        
         // Draw the detected corners on the frame
-        cv::drawChessboardCorners(frame, patternSize, corners, patternFound);
+        {
+            ScopedStageTimer timer(profiler, LatencyProfiler::Stage::DRAW);
+            cv::drawChessboardCorners(frame, patternSize, corners, patternFound);
+        }
         
-        // Deep copy of the frame to ensure independent data storage
-        lastSuccessfulFrame = frame.clone();
-        // Store the corners for calibration
+        // Store the corners for calibration; the buffers are reused once they have the board size
         lastSuccessfulCorners = corners;
         lastFrameSuccess = true;
+        frameSize = frame.size();
 
-        // If camera is calibrated, compute and display pose information
-        if (calibrationDone) {
-            cv::Mat rvec, tvec;
-            if (computePose(rvec, tvec)) {
-                std::cout << "\rRotation vector: [" << std::fixed << std::setprecision(2) 
-                         << rvec.at<double>(0) << ", " 
-                         << rvec.at<double>(1) << ", " 
-                         << rvec.at<double>(2) << "] " 
-                         << "Translation vector: [" 
-                         << tvec.at<double>(0) << ", "
-                         << tvec.at<double>(1) << ", "
-                         << tvec.at<double>(2) << "]     " 
-                         << std::flush;
-                std::stringstream ss;
-                ss << std::fixed << std::setprecision(2);
-                
-                // Display rotation vector on frame
-                ss << "R: [" << rvec.at<double>(0) << ", " 
-                        << rvec.at<double>(1) << ", " 
-                        << rvec.at<double>(2) << "]";
-                cv::putText(frame, ss.str(), cv::Point(10, 60), 
-                        cv::FONT_HERSHEY_SIMPLEX, 0.5, 
-                        cv::Scalar(0, 255, 0), 2);
-                
-                // Display translation vector on frame
-                ss.str("");
-                ss << "T: [" << tvec.at<double>(0) << ", "
-                           << tvec.at<double>(1) << ", "
-                           << tvec.at<double>(2) << "]";
-                cv::putText(frame, ss.str(), cv::Point(10, 90), 
-                        cv::FONT_HERSHEY_SIMPLEX, 0.5, 
-                        cv::Scalar(0, 255, 0), 2);
-            }
+        if (framesUndistorted) {
+            // Views from remapped frames are not saved for calibration
+        } else if (!steadyStateMode) {
+            // Snapshot of the frame for saveCalibrationData, written into the existing buffer
+            frame.copyTo(lastSuccessfulFrame);
+        } else if (saveRequested) {
+            saveRequested = false;
+            storeCalibrationView(frame);
+            std::cout << "\nSaved frame " << calibration_frames.size()
+                      << " (using requested detection)" << std::endl;
+        }
+
+        if (autoKeyframes && !framesUndistorted) {
+            considerKeyframe(frame);
+        }
+    } else {
+        // Update state for unsuccessful detection
+        lastFrameSuccess = false;
+    }
+
+    // Status text and console output are produced later from this record, off the detection path
+    ++frameStatus.frameIndex;
+    frameStatus.patternFound = patternFound;
+    frameStatus.calibrated = calibrationDone;
+    frameStatus.poseValid = false;
+    frameStatus.poseExtrapolated = false;
+    frameStatus.undistorted = framesUndistorted;
+    frameStatus.reprojectionError = -1.0f;
+    frameStatus.lastSuccessAvailable = !lastSuccessfulCorners.empty();
+    frameStatus.savedFrames = static_cast<uint32_t>(corner_list.size());
+
+    // Extra boards are searched in the same converted frame, away from the primary board
+    if (!targets.empty() && calibrationDone) {
+        searchTargets(frame, patternFound ? cv::boundingRect(corners) : cv::Rect());
+    }
+
+    // Keep this frame for optical flow on the next one; the old buffer is reused by cvtColor
+    std::swap(grayFrame, previousGray);
+    
+    return patternFound;
+}
+
+void AugmentedReality::finishFrame() {
+    // One record per frame, after the pose stage has filled in its part
+    if (telemetrySink) {
+        telemetrySink->publish(frameStatus);
+    }
+}
+
+void AugmentedReality::drawOverlay(cv::Mat& frame, const FrameStatus& status) {
+    if (status.patternFound) {
+        if (status.calibrated && status.poseValid) {
+            char text[96];
+            
+            // Display rotation vector on frame
+            std::snprintf(text, sizeof(text), "R: [%.2f, %.2f, %.2f]%s",
+                          status.rvec[0], status.rvec[1], status.rvec[2],
+                          status.poseExtrapolated ? " (predicted)" : "");
+            cv::putText(frame, text, cv::Point(10, 60), 
+                    cv::FONT_HERSHEY_SIMPLEX, 0.5, 
+                    cv::Scalar(0, 255, 0), 2);
+            
+            // Display translation vector on frame
+            std::snprintf(text, sizeof(text), "T: [%.2f, %.2f, %.2f]",
+                          status.tvec[0], status.tvec[1], status.tvec[2]);
+            cv::putText(frame, text, cv::Point(10, 90), 
+                    cv::FONT_HERSHEY_SIMPLEX, 0.5, 
+                    cv::Scalar(0, 255, 0), 2);
         }
         
         // Display appropriate message based on calibration status
-        std::string msg = calibrationDone ? 
+        std::string msg = status.calibrated ? 
                          "Calibrated - Showing pose estimation" :
                          "Corners found. Press 's' to save. Saved: " + 
-                         std::to_string(getSavedFramesCount());
+                         std::to_string(status.savedFrames);
         cv::putText(frame, msg, cv::Point(10, 30), cv::FONT_HERSHEY_SIMPLEX, 
                     0.8, cv::Scalar(0, 255, 0), 2);
     } else {
-        // Update state for unsuccessful detection
-        lastFrameSuccess = false;
         cv::putText(frame, "No chessboard detected", cv::Point(10, 30),
                     cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(0, 0, 255), 2);
         
         // Indicate if there's a previously successful frame available
-        if (!lastSuccessfulFrame.empty()) {
+        if (status.lastSuccessAvailable) {
             cv::putText(frame, "Last successful frame available", cv::Point(10, 60),
                     cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(0, 255, 0), 2);
         }
     }
-    
+}
+
+void AugmentedReality::setPoseTrackingEnabled(bool enabled) {
+    poseTrackingEnabled = enabled;
+    poseHistory = 0;
+    hasPrediction = false;
+}
+
+void AugmentedReality::setQualityLevel(QualityController::Level level) {
+    coarseDetection = level >= QualityController::Level::COARSE_DETECTION;
+    subPixIterations = level >= QualityController::Level::FAST_REFINEMENT ? 8 : 30;
+}
+
+void AugmentedReality::setMultiScaleEnabled(bool enabled, int maxWidth) {
+    multiScaleEnabled = enabled;
+    maxDetectionWidth = std::max(1, maxWidth);
+}
+
+bool AugmentedReality::findCorners(const cv::Mat& gray) {
+    const cv::Rect fullFrame(0, 0, gray.cols, gray.rows);
+    bool patternFound = false;
+
+    // Only track when the previous frame was a successful detection
+    if (trackingMode != TrackingMode::FULL_FRAME && lastFrameSuccess && 
+        !lastSuccessfulCorners.empty()) {
+        if (trackingMode == TrackingMode::OPTICAL_FLOW) {
+            patternFound = trackCornersOpticalFlow(gray);
+        }
+
+        cv::Rect region = trackingRegion(gray.size());
+        if (!patternFound && region.area() < fullFrame.area()) {
+            patternFound = findCornersInRegion(gray, region);
+        }
+    }
+
+    // Tracking lost or disabled - search the whole frame
+    if (!patternFound) {
+        patternFound = findCornersInRegion(gray, fullFrame);
+    }
+
+    if (patternFound) {
+        consecutiveMisses = 0;
+        updateSquareSize();
+    } else {
+        ++consecutiveMisses;
+    }
     return patternFound;
 }
 
+bool AugmentedReality::findCornersInRegion(const cv::Mat& gray, const cv::Rect& region) {
+    if (region.empty()) {
+        return false;
+    }
+
+    const int flags = cv::CALIB_CB_ADAPTIVE_THRESH +
+                      cv::CALIB_CB_NORMALIZE_IMAGE +
+                      cv::CALIB_CB_FAST_CHECK;
+    cv::Mat view = gray(region);
+    double scale = (multiScaleEnabled || coarseDetection) ? detectionScale(region.size()) : 1.0;
+    bool patternFound = false;
+
+    if (scale < 1.0) {
+        // Coarse pass on the downscaled image, then map the hits back to full resolution
+        ScopedStageTimer timer(profiler, LatencyProfiler::Stage::FIND_CORNERS);
+        cv::resize(view, scaledGray, cv::Size(), scale, scale, cv::INTER_AREA);
+        patternFound = cv::findChessboardCorners(scaledGray, patternSize, corners, flags);
+        if (patternFound) {
+            const float inverseScale = static_cast<float>(1.0 / scale);
+            for (auto& corner : corners) {
+                corner *= inverseScale;
+            }
+        }
+    }
+
+    // Full resolution search when not scaling, or periodically when the coarse pass keeps missing
+    const int fullResolutionRetryInterval = 8;
+    if (!patternFound && 
+        (scale >= 1.0 || consecutiveMisses % fullResolutionRetryInterval == 0)) {
+        ScopedStageTimer timer(profiler, LatencyProfiler::Stage::FIND_CORNERS);
+        patternFound = cv::findChessboardCorners(view, patternSize, corners, flags);
+    }
+    if (!patternFound) {
+        return false;
+    }
+
+    // Shift corners from region coordinates back to frame coordinates
+    if (region.x != 0 || region.y != 0) {
+        const cv::Point2f offset(static_cast<float>(region.x), static_cast<float>(region.y));
+        for (auto& corner : corners) {
+            corner += offset;
+        }
+    }
+
+    refineCorners(gray);
+    return true;
+}
+
+bool AugmentedReality::trackCornersOpticalFlow(const cv::Mat& gray) {
+    if (previousGray.empty() || previousGray.size() != gray.size()) {
+        return false;
+    }
+
+    {
+        ScopedStageTimer timer(profiler, LatencyProfiler::Stage::FIND_CORNERS);
+        const cv::Size winSize(21, 21);
+        const int maxLevel = 3;
+        cv::calcOpticalFlowPyrLK(previousGray, gray, lastSuccessfulCorners, corners,
+                                 trackStatus, trackError, winSize, maxLevel);
+        for (uchar ok : trackStatus) {
+            if (!ok) {
+                return false;
+            }
+        }
+
+        // Forward-backward check: every corner must flow back to where it came from
+        cv::calcOpticalFlowPyrLK(gray, previousGray, corners, backtrackedCorners,
+                                 trackStatus, trackError, winSize, maxLevel);
+        const float maxBacktrackError = 1.0f;
+        for (size_t i = 0; i < corners.size(); ++i) {
+            if (!trackStatus[i] || 
+                cv::norm(backtrackedCorners[i] - lastSuccessfulCorners[i]) > maxBacktrackError) {
+                return false;
+            }
+        }
+    }
+
+    refineCorners(gray);
+    return true;
+}
+
+// Grows a box by a fraction of its longer side plus a margin and clips it to the frame
+static cv::Rect padRegion(cv::Rect box, float padding, const cv::Size& frameSize) {
+    int pad = static_cast<int>(padding * std::max(box.width, box.height)) + 8;
+    box.x -= pad;
+    box.y -= pad;
+    box.width += 2 * pad;
+    box.height += 2 * pad;
+    return box & cv::Rect(0, 0, frameSize.width, frameSize.height);
+}
+
+cv::Rect AugmentedReality::trackingRegion(const cv::Size& frameSize) const {
+    cv::Rect box = cv::boundingRect(lastSuccessfulCorners);
+    if (hasPrediction) {
+        // Cover the forecast position too, so fast motion stays inside the region
+        box |= cv::boundingRect(predictedCorners);
+    }
+
+    // Pad by a fraction of the board extent to cover the outer squares and inter-frame motion
+    return padRegion(box, trackingPadding, frameSize);
+}
+
+void AugmentedReality::refineCorners(const cv::Mat& gray) {
+    ScopedStageTimer timer(profiler, LatencyProfiler::Stage::CORNER_SUBPIX);
+    cv::cornerSubPix(gray, corners, cv::Size(11,11), cv::Size(-1,-1),
+                    cv::TermCriteria(cv::TermCriteria::EPS + 
+                                   cv::TermCriteria::COUNT, subPixIterations, 0.1));
+}
+
+double AugmentedReality::detectionScale(const cv::Size& searchSize) const {
+    // Squares need roughly this many pixels for findChessboardCorners to stay reliable;
+    // the coarse quality stage accepts smaller squares and a smaller search image
+    const double targetSquarePixels = coarseDetection ? 10.0 : 16.0;
+    const double widthFactor = coarseDetection ? 0.5 : 1.0;
+    const double minScale = 0.125;
+
+    double scale;
+    if (lastFrameSuccess && lastSquareSize > 0.0f) {
+        // Scale so that the board seen last frame keeps usable square sizes
+        scale = targetSquarePixels / lastSquareSize;
+    } else {
+        // Board size unknown - bound the coarse image size instead
+        scale = widthFactor * maxDetectionWidth / 
+                std::max(searchSize.width, searchSize.height);
+    }
+    return std::min(1.0, std::max(minScale, scale));
+}
+
+void AugmentedReality::updateSquareSize() {
+    const int width = patternSize.width;
+    const int height = patternSize.height;
+    if (width < 2 || height < 2 || corners.size() != static_cast<size_t>(width * height)) {
+        return;
+    }
+
+    // Smallest spacing along the outer rows and columns, which bounds the smallest square
+    float smallest = std::numeric_limits<float>::max();
+    for (int j = 0; j + 1 < width; ++j) {
+        smallest = std::min(smallest, static_cast<float>(cv::norm(corners[j + 1] - corners[j])));
+        int last = (height - 1) * width + j;
+        smallest = std::min(smallest, static_cast<float>(cv::norm(corners[last + 1] - corners[last])));
+    }
+    for (int i = 0; i + 1 < height; ++i) {
+        int first = i * width;
+        smallest = std::min(smallest, static_cast<float>(cv::norm(corners[first + width] - corners[first])));
+        int last = first + width - 1;
+        smallest = std::min(smallest, static_cast<float>(cv::norm(corners[last + width] - corners[last])));
+    }
+    lastSquareSize = smallest;
+}
+
 void AugmentedReality::saveCalibrationData() {
+    if (framesUndistorted) {
+        std::cout << "\nSaving views is paused while input frames are undistorted" << std::endl;
+        return;
+    }
+
+    if (steadyStateMode) {
+        // No per-frame snapshot is kept - capture the next successful detection instead
+        saveRequested = true;
+        std::cout << "\nSave requested - the next detected chessboard will be stored" << std::endl;
+        return;
+    }
+
     // Debug print
     std::cout << "\n--- Debug: Attempting to save calibration data ---" << std::endl;
     
@@ -125,15 +431,173 @@ void AugmentedReality::saveCalibrationData() {
     }
     
     // Confirm all the lists are not empty after debug print
-    corner_list.push_back(lastSuccessfulCorners);
-    point_list.push_back(createWorldPoints());
-    calibration_frames.push_back(lastSuccessfulFrame.clone());
+    storeCalibrationView(lastSuccessfulFrame);
     
     std::cout << "\nSaved frame " << calibration_frames.size() 
               << " (using " << (lastFrameSuccess ? "current" : "last successful")
               << " detection)" << std::endl;
 }
 
+// Coverage is counted on a coarse grid over the sensor
+static const int coverageGridCols = 8;
+static const int coverageGridRows = 6;
+
+void AugmentedReality::storeCalibrationView(const cv::Mat& frame) {
+    corner_list.push_back(lastSuccessfulCorners);
+    point_list.push_back(worldPoints);
+    calibration_frames.push_back(frame.clone());
+
+    trackViewCoverage(lastSuccessfulCorners);
+
+    // Encode on the writer's threads; the stored clone is never drawn into. Only file names
+    // that were never streamed are written here: after a keyframe replacement the index is
+    // reused, and a second job for the same file could finish before the first one.
+    // saveAllData writes those views once the streamed jobs are done
+    const size_t view = calibration_frames.size() - 1;
+    const bool stream = sessionWriter != nullptr && view >= streamedFrameFiles;
+    framesOnDisk.push_back(stream);
+    if (stream) {
+        sessionWriter->writeFrame("frame_" + std::to_string(view) + ".png", calibration_frames.back());
+        streamedFrameFiles = view + 1;
+    }
+
+    // Refine an existing model with the new view without blocking the frame loop
+    if (autoRecalibration && (calibrationDone || pendingCalibration.valid())) {
+        calibrateCameraAsync();
+    }
+}
+
+void AugmentedReality::setAutoKeyframes(bool enabled, size_t maxViews) {
+    autoKeyframes = enabled;
+    maxKeyframes = std::max<size_t>(5, maxViews);
+}
+
+void AugmentedReality::trackViewCoverage(const std::vector<cv::Point2f>& viewCorners) {
+    // Track what the saved views cover for keyframe selection
+    if (coverageCounts.empty()) {
+        coverageCounts.assign(coverageGridCols * coverageGridRows, 0);
+    }
+    viewDescriptors.push_back(describeView(viewCorners));
+    for (const auto& corner : viewCorners) {
+        ++coverageCounts[coverageCell(corner)];
+    }
+}
+
+int AugmentedReality::coverageCell(const cv::Point2f& point) const {
+    int col = static_cast<int>(point.x * coverageGridCols / std::max(1, frameSize.width));
+    int row = static_cast<int>(point.y * coverageGridRows / std::max(1, frameSize.height));
+    col = std::min(coverageGridCols - 1, std::max(0, col));
+    row = std::min(coverageGridRows - 1, std::max(0, row));
+    return row * coverageGridCols + col;
+}
+
+AugmentedReality::ViewDescriptor AugmentedReality::describeView(const std::vector<cv::Point2f>& points) const {
+    // Outer corners of the board in detection order: first row start/end, last row end/start
+    const int width = patternSize.width;
+    const int height = patternSize.height;
+    const cv::Point2f& topLeft = points[0];
+    const cv::Point2f& topRight = points[width - 1];
+    const cv::Point2f& bottomRight = points[width * height - 1];
+    const cv::Point2f& bottomLeft = points[width * (height - 1)];
+
+    const float imageWidth = static_cast<float>(std::max(1, frameSize.width));
+    const float imageHeight = static_cast<float>(std::max(1, frameSize.height));
+    cv::Point2f center = (topLeft + topRight + bottomRight + bottomLeft) * 0.25f;
+    std::vector<cv::Point2f> quad = {topLeft, topRight, bottomRight, bottomLeft};
+    float scale = std::sqrt(static_cast<float>(cv::contourArea(quad)) / (imageWidth * imageHeight));
+
+    // Opposite edges differ in length when the board is tilted away from the camera
+    const float epsilon = 1e-3f;
+    float top = static_cast<float>(cv::norm(topRight - topLeft)) + epsilon;
+    float bottom = static_cast<float>(cv::norm(bottomRight - bottomLeft)) + epsilon;
+    float left = static_cast<float>(cv::norm(bottomLeft - topLeft)) + epsilon;
+    float right = static_cast<float>(cv::norm(bottomRight - topRight)) + epsilon;
+    const float tiltWeight = 2.0f;
+
+    cv::Point2f axis = topRight - topLeft;
+    float angle = std::atan2(axis.y, axis.x);
+    const float angleWeight = 0.5f;
+
+    return ViewDescriptor(center.x / imageWidth, center.y / imageHeight, scale,
+                          tiltWeight * std::log(top / bottom), tiltWeight * std::log(left / right),
+                          angleWeight * std::cos(angle), angleWeight * std::sin(angle));
+}
+
+void AugmentedReality::considerKeyframe(const cv::Mat& frame) {
+    const float minNovelty = 0.05f;   // Closer than this to a saved view counts as a duplicate
+    if (coverageCounts.empty()) {
+        coverageCounts.assign(coverageGridCols * coverageGridRows, 0);
+    }
+
+    ViewDescriptor candidate = describeView(lastSuccessfulCorners);
+    float novelty = std::numeric_limits<float>::max();
+    for (const auto& descriptor : viewDescriptors) {
+        novelty = std::min(novelty, static_cast<float>(cv::norm(candidate - descriptor)));
+    }
+    if (novelty < minNovelty) {
+        return;
+    }
+
+    // Corners landing in sparsely covered cells are worth more
+    float coverageGain = 0.0f;
+    for (const auto& corner : lastSuccessfulCorners) {
+        coverageGain += 1.0f / (1 + coverageCounts[coverageCell(corner)]);
+    }
+    coverageGain /= lastSuccessfulCorners.size();
+
+    if (corner_list.size() < maxKeyframes) {
+        storeCalibrationView(frame);
+        std::cout << "\nKeyframe " << corner_list.size() << " added" << std::endl;
+        return;
+    }
+
+    // Full: find the saved view that is most redundant and covers the least on its own
+    size_t weakest = 0;
+    float weakestScore = std::numeric_limits<float>::max();
+    for (size_t i = 0; i < viewDescriptors.size(); ++i) {
+        float redundancy = std::numeric_limits<float>::max();
+        for (size_t j = 0; j < viewDescriptors.size(); ++j) {
+            if (i != j) {
+                redundancy = std::min(redundancy,
+                                      static_cast<float>(cv::norm(viewDescriptors[i] - viewDescriptors[j])));
+            }
+        }
+        float uniqueCoverage = 0.0f;
+        for (const auto& corner : corner_list[i]) {
+            uniqueCoverage += 1.0f / coverageCounts[coverageCell(corner)];
+        }
+        uniqueCoverage /= corner_list[i].size();
+
+        float score = redundancy + uniqueCoverage;
+        if (score < weakestScore) {
+            weakestScore = score;
+            weakest = i;
+        }
+    }
+
+    if (novelty + coverageGain > weakestScore) {
+        removeCalibrationView(weakest);
+        storeCalibrationView(frame);
+        // Later views moved down one slot and the new view went to the end
+        std::cout << "\nKeyframe " << weakest + 1 << " removed, new view stored as keyframe "
+                  << corner_list.size() << std::endl;
+    }
+}
+
+void AugmentedReality::removeCalibrationView(size_t index) {
+    for (const auto& corner : corner_list[index]) {
+        --coverageCounts[coverageCell(corner)];
+    }
+    corner_list.erase(corner_list.begin() + index);
+    point_list.erase(point_list.begin() + index);
+    calibration_frames.erase(calibration_frames.begin() + index);
+    viewDescriptors.erase(viewDescriptors.begin() + index);
+
+    // Later views move down one index, so their streamed files no longer match
+    framesOnDisk.erase(framesOnDisk.begin() + index);
+    std::fill(framesOnDisk.begin() + index, framesOnDisk.end(), false);
+}
+
 void AugmentedReality::calibrateCamera() {
     if (corner_list.size() < 5) {
         std::cout << "\nNot enough calibration frames. Need at least 5, current: " 
@@ -141,20 +605,213 @@ void AugmentedReality::calibrateCamera() {
         return;
     }
 
-    camera_matrix = cv::Mat::eye(3, 3, CV_64F);
-    distortion_coefficients = cv::Mat::zeros(8, 1, CV_64F);
-    std::vector<cv::Mat> rvecs, tvecs;
+    // Finish any background run first so this one starts from its result
+    if (pendingCalibration.valid()) {
+        pendingCalibration.wait();
+        recalibrationPending = false;
+        applyFinishedCalibration();
+    }
+    startCalibration();
+    pendingCalibration.wait();
+    applyFinishedCalibration();
+}
+
+void AugmentedReality::calibrateCameraAsync() {
+    if (corner_list.size() < 5) {
+        std::cout << "\nNot enough calibration frames. Need at least 5, current: " 
+                  << corner_list.size() << std::endl;
+        return;
+    }
 
-    double rms = cv::calibrateCamera(point_list, corner_list, 
-                                   lastSuccessfulFrame.size(),
-                                   camera_matrix, distortion_coefficients, 
-                                   rvecs, tvecs);
+    if (pendingCalibration.valid()) {
+        // Run again with the new views once the current run finishes
+        recalibrationPending = true;
+        return;
+    }
+    std::cout << "\nCalibrating in the background with " << corner_list.size() 
+              << " frames..." << std::endl;
+    startCalibration();
+}
 
+void AugmentedReality::startCalibration() {
+    // Warm start from the current model; the first run starts from identity
+    int flags = 0;
+    cv::Mat cameraMatrix, distortion;
+    if (calibrationDone) {
+        cameraMatrix = camera_matrix.clone();
+        distortion = distortion_coefficients.clone();
+        flags |= cv::CALIB_USE_INTRINSIC_GUESS;
+    } else {
+        cameraMatrix = cv::Mat::eye(3, 3, CV_64F);
+        distortion = cv::Mat::zeros(8, 1, CV_64F);
+    }
+
+    // The worker owns copies of the views, so saving more views does not race with it
+    pendingCalibration = std::async(std::launch::async,
+        [objectPoints = point_list, imagePoints = corner_list, imageSize = frameSize,
+         cameraMatrix, distortion, flags]() mutable {
+            CalibrationResult result;
+            std::vector<cv::Mat> rvecs, tvecs;
+            result.views = imagePoints.size();
+            result.rms = cv::calibrateCamera(objectPoints, imagePoints, imageSize,
+                                             cameraMatrix, distortion, rvecs, tvecs, flags);
+            result.cameraMatrix = cameraMatrix;
+            result.distortion = distortion;
+            return result;
+        });
+}
+
+void AugmentedReality::applyFinishedCalibration() {
+    if (!pendingCalibration.valid() || 
+        pendingCalibration.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return;
+    }
+
+    try {
+        CalibrationResult result = pendingCalibration.get();
+        if (std::isfinite(result.rms)) {
+            camera_matrix = result.cameraMatrix;
+            distortion_coefficients = result.distortion;
+            calibrationDone = true;
+            poseHistory = 0;
+            undistortMapSize = cv::Size();
+            std::cout << "\nCalibration complete!\n" 
+                      << "Frames used: " << result.views << "\n"
+                      << "RMS error: " << result.rms << "\n"
+                      << "Camera matrix:\n" << camera_matrix << "\n"
+                      << "Distortion coefficients:\n" << distortion_coefficients << std::endl;
+        } else {
+            std::cout << "\nCalibration did not converge - keeping the previous model" << std::endl;
+        }
+    } catch (const cv::Exception& e) {
+        std::cerr << "\nCalibration failed: " << e.what() << std::endl;
+    }
+
+    if (recalibrationPending) {
+        recalibrationPending = false;
+        startCalibration();
+    }
+}
+
+void AugmentedReality::setCameraParameters(const cv::Mat& cameraMatrix, const cv::Mat& distCoeffs) {
+    cameraMatrix.convertTo(camera_matrix, CV_64F);
+    distCoeffs.convertTo(distortion_coefficients, CV_64F);
     calibrationDone = true;
-    std::cout << "\nCalibration complete!\n" 
-              << "RMS error: " << rms << "\n"
-              << "Camera matrix:\n" << camera_matrix << "\n"
-              << "Distortion coefficients:\n" << distortion_coefficients << std::endl;
+    poseHistory = 0;
+    undistortMapSize = cv::Size();
+}
+
+// Entry name for a camera at a resolution; FileStorage keys allow letters, digits and '_'
+static std::string intrinsicsKey(const std::string& cameraId, const cv::Size& resolution) {
+    std::string key = "camera_";
+    for (char c : cameraId) {
+        key += std::isalnum(static_cast<unsigned char>(c)) ? c : '_';
+    }
+    return key + "_" + std::to_string(resolution.width) + "x" + std::to_string(resolution.height);
+}
+
+bool AugmentedReality::loadIntrinsics(const std::string& path, const std::string& cameraId,
+                                      const cv::Size& resolution) {
+    cv::FileStorage fs;
+    try {
+        if (!fs.open(path, cv::FileStorage::READ)) {
+            return false;
+        }
+    } catch (const cv::Exception& e) {
+        std::cerr << "Failed to read intrinsics: " << e.what() << std::endl;
+        return false;
+    }
+
+    cv::FileNode entry = fs[intrinsicsKey(cameraId, resolution)];
+    if (entry.empty()) {
+        return false;
+    }
+    cv::Mat cameraMatrix, distCoeffs;
+    entry["camera_matrix"] >> cameraMatrix;
+    entry["dist_coeffs"] >> distCoeffs;
+    if (cameraMatrix.rows != 3 || cameraMatrix.cols != 3 || distCoeffs.empty()) {
+        std::cerr << "Incomplete intrinsics entry in " << path << std::endl;
+        return false;
+    }
+
+    setCameraParameters(cameraMatrix, distCoeffs);
+    return true;
+}
+
+bool AugmentedReality::saveIntrinsics(const std::string& path, const std::string& cameraId,
+                                      const cv::Size& resolution) const {
+    if (!calibrationDone) {
+        return false;
+    }
+
+    // FileStorage cannot update a file in place, so read back the other entries first
+    struct Entry {
+        std::string key;
+        cv::Mat cameraMatrix, distCoeffs;
+        int width, height;
+    };
+    std::vector<Entry> entries;
+    const std::string key = intrinsicsKey(cameraId, resolution);
+    {
+        cv::FileStorage existing;
+        try {
+            existing.open(path, cv::FileStorage::READ);
+        } catch (const cv::Exception&) {
+            // Unreadable file; it is replaced below
+        }
+        if (existing.isOpened()) {
+            cv::FileNode root = existing.root();
+            for (cv::FileNodeIterator it = root.begin(); it != root.end(); ++it) {
+                cv::FileNode node = *it;
+                if (node.name() == key || !node.isMap()) {
+                    continue;
+                }
+                Entry entry;
+                entry.key = node.name();
+                node["camera_matrix"] >> entry.cameraMatrix;
+                node["dist_coeffs"] >> entry.distCoeffs;
+                node["image_width"] >> entry.width;
+                node["image_height"] >> entry.height;
+                entries.push_back(entry);
+            }
+        }
+    }
+    entries.push_back(Entry{key, camera_matrix, distortion_coefficients,
+                            resolution.width, resolution.height});
+
+    cv::FileStorage fs(path, cv::FileStorage::WRITE);
+    if (!fs.isOpened()) {
+        std::cerr << "Failed to open file: " << path << std::endl;
+        return false;
+    }
+    for (const auto& entry : entries) {
+        fs << entry.key << "{";
+        fs << "camera_matrix" << entry.cameraMatrix;
+        fs << "dist_coeffs" << entry.distCoeffs;
+        fs << "image_width" << entry.width;
+        fs << "image_height" << entry.height;
+        fs << "}";
+    }
+    return true;
+}
+
+void AugmentedReality::prepareUndistortMaps(const cv::Size& size) {
+    if (undistortMapSize == size) {
+        return;
+    }
+    // Keep the camera matrix so projections with zero distortion line up with the remapped image
+    cv::initUndistortRectifyMap(camera_matrix, distortion_coefficients, cv::Mat(), camera_matrix,
+                                size, CV_16SC2, undistortMap1, undistortMap2);
+    undistortMapSize = size;
+}
+
+bool AugmentedReality::undistortFrame(const cv::Mat& frame, cv::Mat& undistorted) {
+    if (!calibrationDone) {
+        return false;
+    }
+    prepareUndistortMaps(frame.size());
+    cv::remap(frame, undistorted, undistortMap1, undistortMap2, cv::INTER_LINEAR);
+    return true;
 }
 
 bool AugmentedReality::computePose(cv::Mat& rvec, cv::Mat& tvec) {
@@ -162,49 +819,525 @@ bool AugmentedReality::computePose(cv::Mat& rvec, cv::Mat& tvec) {
         return false;
     }
     
-    std::vector<cv::Point3f> objectPoints = createWorldPoints();
-    return cv::solvePnP(objectPoints, corners, camera_matrix, 
-                       distortion_coefficients, rvec, tvec);
+    bool poseFound = false;
+    {
+        ScopedStageTimer timer(profiler, LatencyProfiler::Stage::SOLVE_PNP);
+        if (poseTrackingEnabled && hasPrediction) {
+            // Warm start: refine the predicted pose with a few Levenberg-Marquardt iterations
+            rvec.create(3, 1, CV_64F);
+            tvec.create(3, 1, CV_64F);
+            for (int i = 0; i < 3; ++i) {
+                rvec.at<double>(i) = predictedRvec[i];
+                tvec.at<double>(i) = predictedTvec[i];
+            }
+            poseFound = cv::solvePnP(worldPoints, corners, camera_matrix, 
+                                     poseDistortion(), rvec, tvec, 
+                                     true, cv::SOLVEPNP_ITERATIVE);
+            // Reject a solution that ended up behind the camera
+            poseFound = poseFound && tvec.at<double>(2) > 0.0;
+        }
+        if (!poseFound) {
+            // Cold start; the board is planar, so IPPE solves it directly when tracking
+            int method = poseTrackingEnabled ? cv::SOLVEPNP_IPPE : cv::SOLVEPNP_ITERATIVE;
+            poseFound = cv::solvePnP(worldPoints, corners, camera_matrix, 
+                                     poseDistortion(), rvec, tvec, 
+                                     false, method);
+        }
+    }
+
+    // Record the pose for the overlay and telemetry consumers
+    frameStatus.poseValid = poseFound;
+    frameStatus.reprojectionError = -1.0f;
+    if (poseFound) {
+        for (int i = 0; i < 3; ++i) {
+            frameStatus.rvec[i] = rvec.at<double>(i);
+            frameStatus.tvec[i] = tvec.at<double>(i);
+        }
+
+        // RMS distance between the detected corners and the board reprojected with this pose
+        ScopedStageTimer timer(profiler, LatencyProfiler::Stage::PROJECT_POINTS);
+        cv::projectPoints(worldPoints, rvec, tvec, camera_matrix, poseDistortion(), reprojectedCorners);
+        frameStatus.reprojectionError = static_cast<float>(
+            cv::norm(corners, reprojectedCorners, cv::NORM_L2) / std::sqrt(static_cast<double>(corners.size())));
+    }
+
+    // Keep the last two poses for the next prediction
+    if (poseTrackingEnabled) {
+        if (poseFound) {
+            previousRvec = lastRvec;
+            previousTvec = lastTvec;
+            lastRvec = cv::Vec3d(frameStatus.rvec[0], frameStatus.rvec[1], frameStatus.rvec[2]);
+            lastTvec = cv::Vec3d(frameStatus.tvec[0], frameStatus.tvec[1], frameStatus.tvec[2]);
+            poseHistory = std::min(poseHistory + 1, 2);
+            lastPoseFrame = frameStatus.frameIndex;
+        } else {
+            poseHistory = 0;
+        }
+    }
+    return poseFound;
+}
+
+bool AugmentedReality::extrapolatePose(cv::Mat& frame, cv::Mat& rvec, cv::Mat& tvec) {
+    // The skipped frame is still shown, so it gets the same remap as detected frames
+    remapInput(frame);
+
+    // Forecast from the last two poses, then count the skipped frame like a detected one
+    bool poseFound = predictPose();
+    ++frameStatus.frameIndex;
+    frameStatus.patternFound = poseFound;
+    frameStatus.calibrated = calibrationDone;
+    frameStatus.poseValid = poseFound;
+    frameStatus.poseExtrapolated = poseFound;
+    frameStatus.undistorted = framesUndistorted;
+    frameStatus.reprojectionError = -1.0f;
+
+    if (poseFound) {
+        rvec.create(3, 1, CV_64F);
+        tvec.create(3, 1, CV_64F);
+        for (int i = 0; i < 3; ++i) {
+            rvec.at<double>(i) = predictedRvec[i];
+            tvec.at<double>(i) = predictedTvec[i];
+            frameStatus.rvec[i] = predictedRvec[i];
+            frameStatus.tvec[i] = predictedTvec[i];
+        }
+
+        // The forecast becomes the newest pose so the next frame predicts from it
+        previousRvec = lastRvec;
+        previousTvec = lastTvec;
+        lastRvec = predictedRvec;
+        lastTvec = predictedTvec;
+        poseHistory = std::min(poseHistory + 1, 2);
+        lastPoseFrame = frameStatus.frameIndex;
+    }
+    return poseFound;
+}
+
+bool AugmentedReality::predictPose() {
+    // Only forecast from a pose tracked on the immediately preceding frame
+    if (!poseTrackingEnabled || !calibrationDone || poseHistory == 0 || 
+        lastPoseFrame != frameStatus.frameIndex) {
+        return false;
+    }
+
+    if (poseHistory == 1) {
+        // A single pose: assume the board has not moved
+        predictedRvec = lastRvec;
+        predictedTvec = lastTvec;
+    } else {
+        // Constant velocity: apply the motion between the last two frames once more
+        cv::Matx33d lastRotation, previousRotation, predictedRotation;
+        cv::Rodrigues(lastRvec, lastRotation);
+        cv::Rodrigues(previousRvec, previousRotation);
+        cv::Matx33d deltaRotation = lastRotation * previousRotation.t();
+        cv::Vec3d deltaTranslation = lastTvec - deltaRotation * previousTvec;
+        predictedRotation = deltaRotation * lastRotation;
+        cv::Rodrigues(predictedRotation, predictedRvec);
+        predictedTvec = deltaRotation * lastTvec + deltaTranslation;
+    }
+
+    ScopedStageTimer timer(profiler, LatencyProfiler::Stage::PROJECT_POINTS);
+    cv::projectPoints(worldPoints, predictedRvec, predictedTvec, camera_matrix, 
+                      poseDistortion(), predictedCorners);
+    return true;
+}
+
+// Which of the first count frame_<i>.png files the writer last failed to write
+static std::vector<bool> failedFrames(const SessionWriter& writer, size_t count) {
+    const std::vector<std::string> names = writer.failedFiles();
+    std::vector<bool> failed(count, false);
+    for (size_t i = 0; i < count && !names.empty(); ++i) {
+        const std::string name = "frame_" + std::to_string(i) + ".png";
+        failed[i] = std::find(names.begin(), names.end(), name) != names.end();
+    }
+    return failed;
 }
 
 void AugmentedReality::saveAllData(const std::string& directory) {
-    system(("mkdir -p " + directory).c_str());
-    
-    if (!CSVUtil::save2DPoints(directory + "/corners.csv", corner_list)) {
-        std::cerr << "Failed to save corner data" << std::endl;
+    // Save the newest model if a background calibration is still running
+    if (pendingCalibration.valid()) {
+        pendingCalibration.wait();
+        recalibrationPending = false;
+        applyFinishedCalibration();
     }
-    
-    if (!CSVUtil::save3DPoints(directory + "/points.csv", point_list)) {
-        std::cerr << "Failed to save 3D points data" << std::endl;
+
+    // Reuse the streaming writer if it already targets this directory
+    std::unique_ptr<SessionWriter> localWriter;
+    SessionWriter* writer = sessionWriter;
+    if (writer == nullptr || writer->directory() != directory) {
+        localWriter.reset(new SessionWriter(directory));
+        writer = localWriter.get();
     }
-    
-    if (!CSVUtil::saveSummary(directory + "/summary.csv", 
-                             calibration_frames.size(), 
-                             patternSize)) {
-        std::cerr << "Failed to save summary data" << std::endl;
+    const bool streamed = (writer == sessionWriter);
+    if (streamed) {
+        // Files rewritten or removed below must not race with frames still being streamed
+        writer->wait();
+        // Streamed frames that failed are written again below
+        const std::vector<bool> failed = failedFrames(*writer, calibration_frames.size());
+        for (size_t i = 0; i < failed.size(); ++i) {
+            framesOnDisk[i] = framesOnDisk[i] && !failed[i];
+        }
     }
+
+    // Every file is an independent task; the tasks only read, and wait() below keeps them valid
+    writer->writeFile("corners.csv", [this](const std::string& path) {
+        return CSVUtil::save2DPoints(path, corner_list);
+    });
+    writer->writeFile("points.csv", [this](const std::string& path) {
+        return CSVUtil::save3DPoints(path, point_list);
+    });
+    writer->writeFile("summary.csv", [this](const std::string& path) {
+        return CSVUtil::saveSummary(path, calibration_frames.size(), patternSize);
+    });
     
     for(size_t i = 0; i < calibration_frames.size(); ++i) {
-        std::string filename = directory + "/frame_" + 
-                             std::to_string(i) + ".png";
-        if (!cv::imwrite(filename, calibration_frames[i])) {
-            std::cerr << "Failed to save frame " << i << std::endl;
+        if (calibration_frames[i].empty() || (streamed && framesOnDisk[i])) {
+            continue;  // Resumed without its image, or already streamed
+        }
+        writer->writeFrame("frame_" + std::to_string(i) + ".png", calibration_frames[i]);
+    }
+
+    // Frames streamed under indices that no longer exist after keyframe replacement
+    if (streamed) {
+        for (size_t i = calibration_frames.size(); i < streamedFrameFiles; ++i) {
+            std::remove((directory + "/frame_" + std::to_string(i) + ".png").c_str());
         }
     }
     
     // Save camera calibration parameters if calibrated
     if (calibrationDone) {
-        cv::FileStorage fs(directory + "/camera_params.yml", cv::FileStorage::WRITE);
-        fs << "camera_matrix" << camera_matrix;
-        fs << "dist_coeffs" << distortion_coefficients;
-        fs.release();
+        writer->writeFile("camera_params.yml", [this](const std::string& path) {
+            cv::FileStorage fs(path, cv::FileStorage::WRITE);
+            if (!fs.isOpened()) {
+                return false;
+            }
+            fs << "camera_matrix" << camera_matrix;
+            fs << "dist_coeffs" << distortion_coefficients;
+            fs.release();
+            return true;
+        });
+    }
+
+    writer->writeFile("session.bin", [this](const std::string& path) {
+        return saveSession(path);
+    });
+
+    size_t failed = writer->wait([](const SessionWriter::Progress& progress) {
+        std::cout << "\rWriting files: " << progress.written + progress.failed
+                  << "/" << progress.queued << std::flush;
+    });
+    std::cout << std::endl;
+
+    if (streamed) {
+        // Frames that failed again stay off disk, so the next save retries them
+        const std::vector<bool> failed = failedFrames(*writer, calibration_frames.size());
+        for (size_t i = 0; i < calibration_frames.size(); ++i) {
+            framesOnDisk[i] = !calibration_frames[i].empty() && !failed[i];
+        }
+        streamedFrameFiles = calibration_frames.size();
     }
     
     std::cout << "Saved " << calibration_frames.size() << " frames to " 
-              << directory << " directory" << std::endl;
+              << directory << " directory";
+    if (failed > 0) {
+        std::cout << " (" << failed << " files failed)";
+    }
+    std::cout << std::endl;
+}
+
+bool AugmentedReality::saveSession(const std::string& path) {
+    CalibrationSession::SessionData data;
+    data.boardSize = patternSize;
+    data.imageSize = frameSize;
+    data.worldPoints = worldPoints;
+    data.corners = corner_list;
+    if (calibrationDone) {
+        data.cameraMatrix = camera_matrix;
+        data.distortion = distortion_coefficients;
+    }
+    return CalibrationSession::write(path, data);
+}
+
+bool AugmentedReality::resumeSession(const std::string& path, const cv::Size& imageSize) {
+    CalibrationSession::MappedSession session;
+    if (!session.open(path)) {
+        std::cerr << "Failed to open session: " << path << std::endl;
+        return false;
+    }
+    if (session.boardSize() != patternSize) {
+        std::cerr << "Session board is " << session.boardSize() << ", expected "
+                  << patternSize << std::endl;
+        return false;
+    }
+    // Before the first frame only the caller knows the resolution; its views and intrinsics
+    // are only valid at the size they were recorded at
+    const cv::Size cameraSize = imageSize.area() > 0 ? imageSize : frameSize;
+    if (cameraSize.area() > 0 && session.imageSize().area() > 0 && cameraSize != session.imageSize()) {
+        std::cerr << "Session was recorded at " << session.imageSize() << ", camera runs at "
+                  << cameraSize << std::endl;
+        return false;
+    }
+    if (frameSize.area() == 0) {
+        frameSize = session.imageSize().area() > 0 ? session.imageSize() : imageSize;
+    }
+
+    // Every view shares the board geometry, so only the corners are copied
+    const size_t pointsPerView = worldPoints.size();
+    const size_t views = session.viewCount();
+    corner_list.reserve(corner_list.size() + views);
+    point_list.reserve(point_list.size() + views);
+    calibration_frames.reserve(calibration_frames.size() + views);
+    for (size_t i = 0; i < views; ++i) {
+        const cv::Point2f* viewCorners = session.view(i);
+        corner_list.emplace_back(viewCorners, viewCorners + pointsPerView);
+        point_list.push_back(worldPoints);
+        calibration_frames.push_back(cv::Mat());
+        framesOnDisk.push_back(false);
+        trackViewCoverage(corner_list.back());
+    }
+
+    cv::Mat cameraMatrix, distortion;
+    if (!calibrationDone && session.intrinsics(cameraMatrix, distortion)) {
+        setCameraParameters(cameraMatrix, distortion);
+    }
+
+    std::cout << "Resumed " << views << " views from " << path
+              << (calibrationDone ? " (calibrated)" : "") << std::endl;
+    return true;
+}
+
+size_t AugmentedReality::addTarget(const cv::Size& boardSize) {
+    Target target;
+    target.boardSize = boardSize;
+    target.worldPoints = createWorldPoints(boardSize);
+    target.scene = scene;
+    targets.push_back(target);
+    targetDetections.resize(targets.size());
+    if (!targetPool) {
+        targetPool.reset(new ThreadPool());
+    }
+    return targets.size() - 1;
+}
+
+// Mean of a board's corners
+static cv::Point2f boardCenter(const std::vector<cv::Point2f>& points) {
+    cv::Point2f sum;
+    for (const auto& point : points) {
+        sum += point;
+    }
+    return sum * (1.0f / std::max<size_t>(1, points.size()));
+}
+
+// Searches one region of the gray frame for a board, refines its corners with at most
+// subPixIterations steps and solves its pose. Runs on a worker thread and only reads the shared inputs
+static AugmentedReality::TargetDetection solveTargetRegion(const cv::Mat& gray, const cv::Rect& region,
+                                                           const cv::Size& boardSize,
+                                                           const std::vector<cv::Point3f>& worldPoints,
+                                                           const cv::Mat& cameraMatrix,
+                                                           const cv::Mat& distortion,
+                                                           int subPixIterations) {
+    AugmentedReality::TargetDetection detection;
+    const int flags = cv::CALIB_CB_ADAPTIVE_THRESH +
+                      cv::CALIB_CB_NORMALIZE_IMAGE +
+                      cv::CALIB_CB_FAST_CHECK;
+    if (region.empty() || !cv::findChessboardCorners(gray(region), boardSize, detection.corners, flags)) {
+        return detection;
+    }
+
+    const cv::Point2f offset(static_cast<float>(region.x), static_cast<float>(region.y));
+    for (auto& corner : detection.corners) {
+        corner += offset;
+    }
+    cv::cornerSubPix(gray, detection.corners, cv::Size(11,11), cv::Size(-1,-1),
+                    cv::TermCriteria(cv::TermCriteria::EPS + 
+                                   cv::TermCriteria::COUNT, subPixIterations, 0.1));
+    detection.found = true;
+
+    if (!cameraMatrix.empty()) {
+        // The board is planar, so IPPE solves it directly
+        detection.poseValid = cv::solvePnP(worldPoints, detection.corners, cameraMatrix, distortion,
+                                           detection.rvec, detection.tvec, false, cv::SOLVEPNP_IPPE);
+    }
+    return detection;
+}
+
+void AugmentedReality::searchTargets(cv::Mat& frame, const cv::Rect& primaryBox) {
+    const cv::Mat& gray = grayFrame;
+    const cv::Mat cameraMatrix = calibrationDone ? camera_matrix : cv::Mat();
+    const cv::Mat distortion = poseDistortion();
+    const int iterations = subPixIterations;    // Follows the quality level like the primary board
+    std::vector<TargetDetection> previous(targets.size());
+    previous.swap(targetDetections);
+
+    {
+        ScopedStageTimer timer(profiler, LatencyProfiler::Stage::FIND_CORNERS);
+
+        // Targets seen on the last frame are searched near their last position first
+        std::vector<std::future<TargetDetection>> tracked(targets.size());
+        for (size_t i = 0; i < targets.size(); ++i) {
+            if (!previous[i].found) {
+                continue;
+            }
+            const Target& target = targets[i];
+            cv::Rect region = padRegion(cv::boundingRect(previous[i].corners), trackingPadding, gray.size());
+            tracked[i] = targetPool->submit([&gray, &target, region, cameraMatrix, distortion, iterations] {
+                return solveTargetRegion(gray, region, target.boardSize, target.worldPoints,
+                                         cameraMatrix, distortion, iterations);
+            });
+        }
+
+        std::vector<cv::Rect> claimed;          // Boxes of the boards assigned so far
+        std::vector<size_t> missing;            // Targets still to be found
+        if (primaryBox.area() > 0) {
+            claimed.push_back(primaryBox);
+        }
+        for (size_t i = 0; i < targets.size(); ++i) {
+            if (tracked[i].valid()) {
+                targetDetections[i] = tracked[i].get();
+                // A target that moved away can be tracked onto the primary board instead
+                if (targetDetections[i].found && primaryBox.contains(boardCenter(targetDetections[i].corners))) {
+                    targetDetections[i] = TargetDetection();
+                }
+            }
+            if (targetDetections[i].found) {
+                claimed.push_back(cv::boundingRect(targetDetections[i].corners));
+            } else {
+                missing.push_back(i);
+            }
+        }
+
+        if (!missing.empty()) {
+            // One search per board size and candidate region; targets of one size share the results
+            std::vector<cv::Size> boardSizes;
+            std::vector<const Target*> sizeTargets;
+            for (size_t i : missing) {
+                if (std::find(boardSizes.begin(), boardSizes.end(), targets[i].boardSize) == boardSizes.end()) {
+                    boardSizes.push_back(targets[i].boardSize);
+                    sizeTargets.push_back(&targets[i]);
+                }
+            }
+
+            struct Candidate {
+                cv::Size boardSize;
+                std::future<TargetDetection> result;
+                TargetDetection detection;
+                bool taken = false;
+            };
+            std::vector<Candidate> candidates;
+            for (const cv::Rect& region : findTargetRegions(gray)) {
+                // Regions that are mostly an assigned board hold nothing new
+                bool covered = false;
+                for (const cv::Rect& box : claimed) {
+                    covered = covered || (region & box).area() * 2 > region.area();
+                }
+                if (covered) {
+                    continue;
+                }
+                for (const Target* target : sizeTargets) {
+                    Candidate candidate;
+                    candidate.boardSize = target->boardSize;
+                    candidate.result = targetPool->submit([&gray, target, region, cameraMatrix, distortion,
+                                                           iterations] {
+                        return solveTargetRegion(gray, region, target->boardSize, target->worldPoints,
+                                                 cameraMatrix, distortion, iterations);
+                    });
+                    candidates.push_back(std::move(candidate));
+                }
+            }
+            for (auto& candidate : candidates) {
+                candidate.detection = candidate.result.get();
+            }
+
+            for (size_t i : missing) {
+                // Prefer the board closest to where this target was last seen, else the largest region's
+                Candidate* best = nullptr;
+                float bestDistance = std::numeric_limits<float>::max();
+                for (auto& candidate : candidates) {
+                    if (candidate.taken || !candidate.detection.found ||
+                        candidate.boardSize != targets[i].boardSize) {
+                        continue;
+                    }
+                    cv::Point2f center = boardCenter(candidate.detection.corners);
+                    bool duplicate = false;
+                    for (const cv::Rect& box : claimed) {
+                        duplicate = duplicate || box.contains(center);
+                    }
+                    if (duplicate) {
+                        candidate.taken = true;   // Same board found again from an overlapping region
+                        continue;
+                    }
+                    float distance = previous[i].found ?
+                        static_cast<float>(cv::norm(center - boardCenter(previous[i].corners))) : 0.0f;
+                    if (distance < bestDistance) {
+                        bestDistance = distance;
+                        best = &candidate;
+                    }
+                }
+                if (best != nullptr) {
+                    best->taken = true;
+                    targetDetections[i] = std::move(best->detection);
+                    claimed.push_back(cv::boundingRect(targetDetections[i].corners));
+                }
+            }
+        }
+    }
+
+    ScopedStageTimer timer(profiler, LatencyProfiler::Stage::DRAW);
+    for (size_t i = 0; i < targets.size(); ++i) {
+        if (targetDetections[i].found) {
+            cv::drawChessboardCorners(frame, targets[i].boardSize, targetDetections[i].corners, true);
+        }
+    }
 }
 
-std::vector<cv::Point3f> AugmentedReality::createWorldPoints() const {
+std::vector<cv::Rect> AugmentedReality::findTargetRegions(const cv::Mat& gray) {
+    // Boards show up as compact patches of strong edges; look for them on a small copy
+    const double scale = std::min(1.0, 640.0 / std::max(gray.cols, gray.rows));
+    if (scale < 1.0) {
+        cv::resize(gray, targetSearchGray, cv::Size(), scale, scale, cv::INTER_AREA);
+    } else {
+        gray.copyTo(targetSearchGray);
+    }
+    cv::morphologyEx(targetSearchGray, targetMask, cv::MORPH_GRADIENT, cv::Mat());
+    cv::threshold(targetMask, targetMask, 0, 255, cv::THRESH_BINARY | cv::THRESH_OTSU);
+
+    // Close the gaps between squares so each board becomes one blob
+    int kernelSize = std::max(3, std::max(targetMask.cols, targetMask.rows) / 40) | 1;
+    cv::morphologyEx(targetMask, targetMask, cv::MORPH_CLOSE,
+                     cv::getStructuringElement(cv::MORPH_RECT, cv::Size(kernelSize, kernelSize)));
+
+    cv::Mat labels, stats, centroids;
+    int count = cv::connectedComponentsWithStats(targetMask, labels, stats, centroids, 8, CV_32S);
+    const double minArea = 0.005 * targetMask.total();
+    const double inverseScale = 1.0 / scale;
+    std::vector<cv::Rect> regions;
+    for (int i = 1; i < count; ++i) {
+        cv::Rect box(stats.at<int>(i, cv::CC_STAT_LEFT), stats.at<int>(i, cv::CC_STAT_TOP),
+                     stats.at<int>(i, cv::CC_STAT_WIDTH), stats.at<int>(i, cv::CC_STAT_HEIGHT));
+        // Boards fill most of their bounding box, long edges and outlines do not
+        if (box.area() < minArea || stats.at<int>(i, cv::CC_STAT_AREA) < 0.4 * box.area()) {
+            continue;
+        }
+        cv::Rect full(cvFloor(box.x * inverseScale), cvFloor(box.y * inverseScale),
+                      cvCeil(box.width * inverseScale), cvCeil(box.height * inverseScale));
+        // findChessboardCorners needs a quiet border around the board
+        regions.push_back(padRegion(full, 0.1f, gray.size()));
+    }
+
+    // Largest patches first; a bounded number keeps textured backgrounds cheap
+    std::sort(regions.begin(), regions.end(), [](const cv::Rect& a, const cv::Rect& b) {
+        return a.area() > b.area();
+    });
+    const size_t maxRegions = std::max<size_t>(4, 2 * targets.size());
+    if (regions.size() > maxRegions) {
+        regions.resize(maxRegions);
+    }
+    if (regions.empty()) {
+        regions.push_back(cv::Rect(0, 0, gray.cols, gray.rows));
+    }
+    return regions;
+}
+
+std::vector<cv::Point3f> AugmentedReality::createWorldPoints(const cv::Size& patternSize) {
     std::vector<cv::Point3f> points;
     for(int i = 0; i < patternSize.height; ++i) {
         for(int j = 0; j < patternSize.width; ++j) {
@@ -214,52 +1347,57 @@ std::vector<cv::Point3f> AugmentedReality::createWorldPoints() const {
     return points;
 }
 
-void AugmentedReality::draw3DAxis(cv::Mat& frame, const cv::Mat& rvec, const cv::Mat& tvec) {
-    // Define the 3D points for the axis (X, Y, Z). Each axis is 3 units in length.
-    std::vector<cv::Point3f> axisPoints;
-    axisPoints.push_back(cv::Point3f(0, 0, 0));  // Origin
-    axisPoints.push_back(cv::Point3f(3, 0, 0));  // X-axis endpoint
-    axisPoints.push_back(cv::Point3f(0, 3, 0));  // Y-axis endpoint
-    axisPoints.push_back(cv::Point3f(0, 0, -3)); // Z-axis endpoint (negative for upward in image)
-
-    // Project the 3D points to the 2D image plane
-    std::vector<cv::Point2f> imagePoints;
-    cv::projectPoints(axisPoints, rvec, tvec, camera_matrix, distortion_coefficients, imagePoints);
+void AugmentedReality::draw3DAxis(cv::Mat& frame, const cv::Mat& rvec, const cv::Mat& tvec,
+                                  bool frameUndistorted) {
+    // Project the 3D axis points to the 2D image plane
+    {
+        ScopedStageTimer timer(profiler, LatencyProfiler::Stage::PROJECT_POINTS);
+        axisScene.project(rvec, tvec, camera_matrix, distortionFor(frameUndistorted));
+    }
 
-    // Draw the 3D axis on the image
-    cv::line(frame, imagePoints[0], imagePoints[1], cv::Scalar(0, 0, 255), 3); // X-axis in red
-    cv::line(frame, imagePoints[0], imagePoints[2], cv::Scalar(0, 255, 0), 3); // Y-axis in green
-    cv::line(frame, imagePoints[0], imagePoints[3], cv::Scalar(255, 0, 0), 3); // Z-axis in blue
+    // Draw the 3D axis on the image: X in red, Y in green, Z in blue
+    ScopedStageTimer timer(profiler, LatencyProfiler::Stage::DRAW);
+    axisScene.draw(frame);
 }
 
-// Draws the virtual object - a pyramid on the image
-void AugmentedReality::drawVirtualObject(cv::Mat& frame, const cv::Mat& rvec, const cv::Mat& tvec) {
-    if (virtualObjectPoints.empty()) {
-        std::cerr << "Virtual object points not initialized." << std::endl;
+// Draws the virtual scene - a pyramid unless other objects were added
+void AugmentedReality::drawVirtualObject(cv::Mat& frame, const cv::Mat& rvec, const cv::Mat& tvec,
+                                         bool frameUndistorted) {
+    if (scene.objectCount() == 0) {
+        std::cerr << "Virtual scene is empty." << std::endl;
         return;
     }
 
-    // Project 3D points to the 2D image plane
-    std::vector<cv::Point2f> imagePoints;
-    cv::projectPoints(virtualObjectPoints, rvec, tvec, camera_matrix, distortion_coefficients, imagePoints);
+    // One projection pass over the vertices of every object
+    {
+        ScopedStageTimer timer(profiler, LatencyProfiler::Stage::PROJECT_POINTS);
+        scene.project(rvec, tvec, camera_matrix, distortionFor(frameUndistorted));
+    }
 
-    // Draw the base of the pyramid
-    cv::line(frame, imagePoints[0], imagePoints[1], cv::Scalar(255, 0, 0), 2); // Base edges in blue
-    cv::line(frame, imagePoints[1], imagePoints[2], cv::Scalar(255, 0, 0), 2);
-    cv::line(frame, imagePoints[2], imagePoints[3], cv::Scalar(255, 0, 0), 2);
-    cv::line(frame, imagePoints[3], imagePoints[4], cv::Scalar(255, 0, 0), 2);
-    cv::line(frame, imagePoints[4], imagePoints[0], cv::Scalar(255, 0, 0), 2);
+    // Draw every object's edges in its own color
+    ScopedStageTimer timer(profiler, LatencyProfiler::Stage::DRAW);
+    scene.draw(frame);
+}
 
-    // Draw lines from base to the apex of the pyramid
-    cv::line(frame, imagePoints[0], imagePoints[5], cv::Scalar(0, 255, 0), 2); // Lines to apex in green
-    cv::line(frame, imagePoints[1], imagePoints[5], cv::Scalar(0, 255, 0), 2);
-    cv::line(frame, imagePoints[2], imagePoints[5], cv::Scalar(0, 255, 0), 2);
-    cv::line(frame, imagePoints[3], imagePoints[5], cv::Scalar(0, 255, 0), 2);
-    cv::line(frame, imagePoints[4], imagePoints[5], cv::Scalar(0, 255, 0), 2);
+void AugmentedReality::drawTargets(cv::Mat& frame, const std::vector<TargetDetection>& detections,
+                                   bool frameUndistorted) {
+    const size_t count = std::min(detections.size(), targets.size());
+    for (size_t i = 0; i < count; ++i) {
+        if (!detections[i].poseValid || targets[i].scene.objectCount() == 0) {
+            continue;
+        }
+        {
+            ScopedStageTimer timer(profiler, LatencyProfiler::Stage::PROJECT_POINTS);
+            targets[i].scene.project(detections[i].rvec, detections[i].tvec, camera_matrix,
+                                     distortionFor(frameUndistorted));
+        }
+        ScopedStageTimer timer(profiler, LatencyProfiler::Stage::DRAW);
+        targets[i].scene.draw(frame);
+    }
 }
 
 
-std::vector<cv::Point2f> AugmentedReality::getCorners() const {
+const std::vector<cv::Point2f>& AugmentedReality::getCorners() const {
     return corners;
 }
 
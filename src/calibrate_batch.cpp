@@ -0,0 +1,179 @@
+/**
+ * Yanting Lai (002955701)
+ * Fall 2024
+ * CS 5330 Project 4
+ * headless batch calibration from a directory of images
+ */
+
+// calibrate_batch.cpp
+#include "augmented_reality.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Detection result for one image; kept per index so the output does not depend on scheduling
+struct ViewResult {
+    bool found = false;
+    cv::Size imageSize;
+    std::vector<cv::Point2f> corners;
+};
+
+static void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " <image_dir> [options]\n"
+              << "Options:\n"
+              << "  --board WxH      Inner corners per row and column (default 8x6)\n"
+              << "  --pattern GLOB   Image file pattern inside image_dir (default frame_*.png)\n"
+              << "  --threads N      Detection threads, 0 for all cores (default 0)\n"
+              << "  --output FILE    Output parameter file (default <image_dir>/camera_params.yml)\n";
+}
+
+static ViewResult detectView(const std::string& path, const cv::Size& patternSize) {
+    ViewResult result;
+    cv::Mat gray = cv::imread(path, cv::IMREAD_GRAYSCALE);
+    if (gray.empty()) {
+        return result;
+    }
+    result.imageSize = gray.size();
+
+    // Same search and refinement settings as the interactive detector
+    const int flags = cv::CALIB_CB_ADAPTIVE_THRESH +
+                      cv::CALIB_CB_NORMALIZE_IMAGE +
+                      cv::CALIB_CB_FAST_CHECK;
+    result.found = cv::findChessboardCorners(gray, patternSize, result.corners, flags);
+    if (result.found) {
+        cv::cornerSubPix(gray, result.corners, cv::Size(11,11), cv::Size(-1,-1),
+                        cv::TermCriteria(cv::TermCriteria::EPS +
+                                       cv::TermCriteria::COUNT, 30, 0.1));
+    }
+    return result;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printUsage(argv[0]);
+        return -1;
+    }
+
+    std::string directory = argv[1];
+    std::string pattern = "frame_*.png";
+    std::string outputPath = directory + "/camera_params.yml";
+    cv::Size patternSize(8, 6);
+    int threadCount = 0;
+
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--board" && hasValue) {
+            if (std::sscanf(argv[++i], "%dx%d", &patternSize.width, &patternSize.height) != 2) {
+                std::cerr << "Error: Invalid board size: " << argv[i] << std::endl;
+                return -1;
+            }
+        } else if (arg == "--pattern" && hasValue) {
+            pattern = argv[++i];
+        } else if (arg == "--threads" && hasValue) {
+            threadCount = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--output" && hasValue) {
+            outputPath = argv[++i];
+        } else {
+            printUsage(argv[0]);
+            return -1;
+        }
+    }
+
+    std::vector<cv::String> files;
+    cv::glob(directory + "/" + pattern, files, false);
+    std::sort(files.begin(), files.end());
+    if (files.empty()) {
+        std::cerr << "Error: No images matching " << pattern << " in " << directory << std::endl;
+        return -1;
+    }
+
+    std::cout << "Detecting " << patternSize.width << "x" << patternSize.height
+              << " corners in " << files.size() << " images..." << std::endl;
+    auto start = std::chrono::steady_clock::now();
+
+    // One task per image; results are collected in file order
+    std::vector<ViewResult> results(files.size());
+    {
+        ThreadPool pool(static_cast<size_t>(threadCount));
+        std::vector<std::future<ViewResult>> pending;
+        pending.reserve(files.size());
+        for (const auto& file : files) {
+            std::string path = file;
+            pending.push_back(pool.submit([path, patternSize] {
+                return detectView(path, patternSize);
+            }));
+        }
+        for (size_t i = 0; i < pending.size(); ++i) {
+            results[i] = pending[i].get();
+        }
+    }
+
+    double detectSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Keep views in file order; all must share the resolution of the first usable image
+    std::vector<std::vector<cv::Point2f>> corner_list;
+    std::vector<std::vector<cv::Point3f>> point_list;
+    const std::vector<cv::Point3f> worldPoints = AugmentedReality::createWorldPoints(patternSize);
+    cv::Size imageSize;
+    for (size_t i = 0; i < results.size(); ++i) {
+        const ViewResult& view = results[i];
+        if (view.imageSize.area() == 0) {
+            std::cerr << "Failed to load " << files[i] << std::endl;
+            continue;
+        }
+        if (!view.found) {
+            std::cout << "No chessboard detected in " << files[i] << std::endl;
+            continue;
+        }
+        if (imageSize.area() == 0) {
+            imageSize = view.imageSize;
+        } else if (view.imageSize != imageSize) {
+            std::cerr << "Skipping " << files[i] << ": size " << view.imageSize
+                      << " differs from " << imageSize << std::endl;
+            continue;
+        }
+        corner_list.push_back(view.corners);
+        point_list.push_back(worldPoints);
+    }
+
+    std::cout << "Detected the board in " << corner_list.size() << " of " << files.size()
+              << " images in " << std::fixed << std::setprecision(2) << detectSec << " s" << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+
+    if (corner_list.size() < 5) {
+        std::cout << "Not enough calibration frames. Need at least 5, current: "
+                  << corner_list.size() << std::endl;
+        return -1;
+    }
+
+    cv::Mat camera_matrix = cv::Mat::eye(3, 3, CV_64F);
+    cv::Mat distortion_coefficients = cv::Mat::zeros(8, 1, CV_64F);
+    std::vector<cv::Mat> rvecs, tvecs;
+    double rms = cv::calibrateCamera(point_list, corner_list, imageSize,
+                                   camera_matrix, distortion_coefficients,
+                                   rvecs, tvecs);
+
+    cv::FileStorage fs(outputPath, cv::FileStorage::WRITE);
+    if (!fs.isOpened()) {
+        std::cerr << "Failed to open file: " << outputPath << std::endl;
+        return -1;
+    }
+    fs << "camera_matrix" << camera_matrix;
+    fs << "dist_coeffs" << distortion_coefficients;
+    fs.release();
+
+    std::cout << "\nCalibration complete!\n"
+              << "RMS error: " << rms << "\n"
+              << "Camera matrix:\n" << camera_matrix << "\n"
+              << "Distortion coefficients:\n" << distortion_coefficients << "\n"
+              << "Saved camera parameters to " << outputPath << std::endl;
+    return 0;
+}
@@ -0,0 +1,184 @@
+/**
+ * Yanting Lai (002955701)
+ * Fall 2024
+ * CS 5330 Project 4
+ * cpp file for calibration session
+ */
+
+// calibration_session.cpp
+#include "calibration_session.h"
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace CalibrationSession {
+
+static_assert(sizeof(SessionHeader) == 184, "SessionHeader layout is part of the file format");
+static_assert(sizeof(cv::Point2f) == 2 * sizeof(float) && sizeof(cv::Point3f) == 3 * sizeof(float),
+              "Corner arrays are mapped directly onto cv::Point2f/cv::Point3f");
+
+// Writes the whole buffer, retrying short writes
+static bool writeAll(int fd, const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t written = ::write(fd, bytes, size);
+        if (written <= 0) {
+            return false;
+        }
+        bytes += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+bool write(const std::string& path, const SessionData& data) {
+    const size_t pointsPerView = data.worldPoints.size();
+    for (const auto& view : data.corners) {
+        if (view.size() != pointsPerView) {
+            std::cerr << "Session view has " << view.size() << " corners, expected "
+                      << pointsPerView << std::endl;
+            return false;
+        }
+    }
+
+    SessionHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, magic, sizeof(header.magic));
+    header.version = currentVersion;
+    header.headerSize = sizeof(SessionHeader);
+    header.boardWidth = data.boardSize.width;
+    header.boardHeight = data.boardSize.height;
+    header.imageWidth = data.imageSize.width;
+    header.imageHeight = data.imageSize.height;
+    header.pointsPerView = static_cast<uint32_t>(pointsPerView);
+    header.viewCount = data.corners.size();
+    if (!data.cameraMatrix.empty()) {
+        header.flags |= hasIntrinsics;
+        cv::Mat K, D;
+        data.cameraMatrix.convertTo(K, CV_64F);
+        data.distortion.convertTo(D, CV_64F);
+        for (int i = 0; i < 9; ++i) {
+            header.cameraMatrix[i] = K.at<double>(i / 3, i % 3);
+        }
+        for (int i = 0; i < 8 && i < static_cast<int>(D.total()); ++i) {
+            header.distortion[i] = D.ptr<double>()[i];
+        }
+    }
+
+    // Write next to the target and rename, so an interrupted save keeps the previous session
+    const std::string tempPath = path + ".tmp";
+    int fd = ::open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::cerr << "Failed to open file: " << tempPath << std::endl;
+        return false;
+    }
+
+    bool ok = writeAll(fd, &header, sizeof(header)) &&
+              writeAll(fd, data.worldPoints.data(), pointsPerView * sizeof(cv::Point3f));
+    for (size_t i = 0; ok && i < data.corners.size(); ++i) {
+        ok = writeAll(fd, data.corners[i].data(), pointsPerView * sizeof(cv::Point2f));
+    }
+    ok = (::close(fd) == 0) && ok;
+
+    if (!ok || std::rename(tempPath.c_str(), path.c_str()) != 0) {
+        std::cerr << "Failed to write session: " << path << std::endl;
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+MappedSession::MappedSession()
+    : mapping(nullptr),
+      mappingSize(0),
+      header(nullptr),
+      world(nullptr),
+      corners(nullptr) {}
+
+MappedSession::~MappedSession() {
+    close();
+}
+
+bool MappedSession::open(const std::string& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(SessionHeader))) {
+        ::close(fd);
+        std::cerr << "Session file is too short: " << path << std::endl;
+        return false;
+    }
+
+    size_t size = static_cast<size_t>(st.st_size);
+    void* address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);  // The mapping stays valid after the descriptor is closed
+    if (address == MAP_FAILED) {
+        std::cerr << "Failed to map session: " << path << std::endl;
+        return false;
+    }
+
+    const SessionHeader* candidate = static_cast<const SessionHeader*>(address);
+    const char* base = static_cast<const char*>(address);
+    bool valid = std::memcmp(candidate->magic, magic, sizeof(magic)) == 0 &&
+                 candidate->version == currentVersion &&
+                 candidate->headerSize == sizeof(SessionHeader) &&
+                 candidate->boardWidth > 0 && candidate->boardHeight > 0 &&
+                 uint64_t(candidate->pointsPerView) ==
+                     uint64_t(candidate->boardWidth) * uint64_t(candidate->boardHeight);
+    if (valid) {
+        // The corner array must fit exactly; a shorter file means an interrupted write.
+        // Checked by division so a corrupt view count cannot wrap the size product
+        const uint64_t fixedBytes = sizeof(SessionHeader) +
+                                    uint64_t(candidate->pointsPerView) * sizeof(cv::Point3f);
+        const uint64_t viewBytes = uint64_t(candidate->pointsPerView) * sizeof(cv::Point2f);
+        valid = fixedBytes <= size &&
+                (size - fixedBytes) % viewBytes == 0 &&
+                candidate->viewCount == (size - fixedBytes) / viewBytes;
+    }
+    if (!valid) {
+        munmap(address, size);
+        std::cerr << "Not a version " << currentVersion << " session file: " << path << std::endl;
+        return false;
+    }
+
+    mapping = address;
+    mappingSize = size;
+    header = candidate;
+    world = reinterpret_cast<const cv::Point3f*>(base + sizeof(SessionHeader));
+    corners = reinterpret_cast<const cv::Point2f*>(base + sizeof(SessionHeader) +
+                                                   header->pointsPerView * sizeof(cv::Point3f));
+
+    // Views are read front to back when a session is resumed
+    madvise(mapping, mappingSize, MADV_SEQUENTIAL);
+    return true;
+}
+
+void MappedSession::close() {
+    if (mapping != nullptr) {
+        munmap(mapping, mappingSize);
+    }
+    mapping = nullptr;
+    mappingSize = 0;
+    header = nullptr;
+    world = nullptr;
+    corners = nullptr;
+}
+
+bool MappedSession::intrinsics(cv::Mat& cameraMatrix, cv::Mat& distortion) const {
+    if (!(header->flags & hasIntrinsics)) {
+        return false;
+    }
+    cameraMatrix = cv::Mat(3, 3, CV_64F, const_cast<double*>(header->cameraMatrix)).clone();
+    distortion = cv::Mat(8, 1, CV_64F, const_cast<double*>(header->distortion)).clone();
+    return true;
+}
+
+} // namespace CalibrationSession
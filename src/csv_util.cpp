@@ -7,74 +7,418 @@
 
 // csv_util.cpp
 #include "csv_util.h"
-#include <iostream>
+#include "session_writer.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <iostream>
 
 void CSVUtil::createDirectory(const std::string& path) {
-    std::string dir = path.substr(0, path.find_last_of("/\\"));
-    if (!dir.empty()) {
-        int result = system(("mkdir -p " + dir).c_str());
-        if (result != 0) {
-            std::cerr << "Failed to create directory: " << dir << std::endl;
+    size_t separator = path.find_last_of("/\\");
+    if (separator == std::string::npos) {
+        return;  // File in the working directory
+    }
+    std::string dir = path.substr(0, separator);
+    if (!SessionWriter::createDirectories(dir)) {
+        std::cerr << "Failed to create directory: " << dir << std::endl;
+    }
+}
+
+// Output is staged here and written in large chunks; one buffer per thread so the
+// session writer can export several files at once
+static const size_t csvChunkSize = 1 << 20;
+
+namespace {
+
+const double powersOfTen[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13};
+
+/**
+ * Writes the shortest decimal string that reads back as the same float, without printf in
+ * the common range. Digit counts are tried from one upward; a candidate is accepted when it
+ * lies within half the float spacing of the value, and ties near that bound are settled with
+ * strtof. Values outside [1e-4, 1e9) use %.9g, which always round-trips.
+ */
+int formatShortestFloat(char* out, float value) {
+    const float magnitude = std::fabs(value);
+    if (!(magnitude >= 1e-4f && magnitude < 1e9f)) {
+        if (value == 0.0f) {
+            out[0] = '0';
+            out[1] = '\0';
+            return 1;
+        }
+        return std::snprintf(out, 32, "%.9g", value);
+    }
+
+    // Decimal exponent of the leading digit
+    const double target = magnitude;
+    int exponent = 0;
+    if (target >= 1.0) {
+        while (exponent < 8 && target >= powersOfTen[exponent + 1]) {
+            ++exponent;
+        }
+    } else {
+        exponent = -1;
+        while (target < 1.0 / powersOfTen[-exponent]) {
+            --exponent;
+        }
+    }
+
+    const double upGap = std::nextafter(magnitude, INFINITY) - magnitude;
+    const double downGap = magnitude - std::nextafter(magnitude, 0.0f);
+    for (int digits = 1; digits <= 9; ++digits) {
+        // value ~ mantissa * 10^-shift with the requested number of digits
+        const int shift = digits - 1 - exponent;
+        uint64_t mantissa;
+        double candidate;
+        if (shift >= 0) {
+            mantissa = static_cast<uint64_t>(std::llround(target * powersOfTen[shift]));
+            candidate = mantissa / powersOfTen[shift];
+        } else {
+            mantissa = static_cast<uint64_t>(std::llround(target / powersOfTen[-shift]));
+            candidate = mantissa * powersOfTen[-shift];
+        }
+        const double distance = std::fabs(candidate - target);
+        const double halfGap = 0.5 * (candidate >= target ? upGap : downGap);
+        if (distance > halfGap * (1 + 1e-9)) {
+            continue;
+        }
+
+        // Digits of the mantissa, least significant first
+        char reversed[24];
+        int length = 0;
+        do {
+            reversed[length++] = static_cast<char>('0' + mantissa % 10);
+            mantissa /= 10;
+        } while (mantissa != 0);
+
+        char* cursor = out;
+        if (value < 0) {
+            *cursor++ = '-';
+        }
+        if (shift <= 0) {
+            while (length > 0) {
+                *cursor++ = reversed[--length];
+            }
+            for (int i = 0; i < -shift; ++i) {
+                *cursor++ = '0';
+            }
+        } else {
+            int trailingZeros = 0;
+            while (trailingZeros < shift && trailingZeros < length && reversed[trailingZeros] == '0') {
+                ++trailingZeros;
+            }
+            if (length <= shift) {
+                *cursor++ = '0';
+            } else {
+                for (int i = length - 1; i >= shift; --i) {
+                    *cursor++ = reversed[i];
+                }
+            }
+            if (trailingZeros < shift) {
+                *cursor++ = '.';
+                for (int i = shift - 1; i >= trailingZeros; --i) {
+                    *cursor++ = i < length ? reversed[i] : '0';
+                }
+            }
+        }
+        *cursor = '\0';
+
+        if (distance < halfGap * (1 - 1e-9) || std::strtof(out, nullptr) == value) {
+            return static_cast<int>(cursor - out);
         }
     }
+    return std::snprintf(out, 32, "%.9g", value);
 }
 
+class ChunkedCsvWriter {
+public:
+    explicit ChunkedCsvWriter(const std::string& filename)
+        : file(std::fopen(filename.c_str(), "wb")),
+          failed(file == nullptr),
+          buffer(sharedBuffer()) {
+        buffer.clear();
+    }
+
+    ~ChunkedCsvWriter() {
+        if (file != nullptr) {
+            std::fclose(file);
+        }
+    }
+
+    bool isOpen() const { return file != nullptr; }
+
+    void text(const char* value) {
+        buffer.append(value);
+        flushIfFull();
+    }
+
+    void index(size_t value) {
+        // Digits are produced backwards into a small scratch array
+        char digits[24];
+        int length = 0;
+        do {
+            digits[length++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value != 0);
+        while (length > 0) {
+            buffer.push_back(digits[--length]);
+        }
+    }
+
+    void number(float value) {
+        char digits[32];
+        buffer.append(digits, formatShortestFloat(digits, value));
+    }
+
+    void separator() { buffer.push_back(','); }
+
+    void endRow() {
+        buffer.push_back('\n');
+        flushIfFull();
+    }
+
+    bool close() {
+        flush();
+        if (file != nullptr && std::fclose(file) != 0) {
+            failed = true;
+        }
+        file = nullptr;
+        return !failed;
+    }
+
+private:
+    static std::string& sharedBuffer() {
+        thread_local std::string staging;
+        if (staging.capacity() < csvChunkSize + 4096) {
+            staging.reserve(csvChunkSize + 4096);
+        }
+        return staging;
+    }
+
+    void flushIfFull() {
+        if (buffer.size() >= csvChunkSize) {
+            flush();
+        }
+    }
+
+    void flush() {
+        if (file != nullptr && !buffer.empty() &&
+            std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size()) {
+            failed = true;
+        }
+        buffer.clear();
+    }
+
+    FILE* file;
+    bool failed;
+    std::string& buffer;
+};
+
+/**
+ * Streams a CSV file in chunks and hands every data row to the handler as parsed numbers.
+ * The header row is skipped; a row with a different number of fields, or one the handler
+ * rejects by returning false, fails the whole read.
+ */
+template <typename RowHandler>
+bool parseNumericCsv(const std::string& filename, int columns, RowHandler handleRow) {
+    FILE* file = std::fopen(filename.c_str(), "rb");
+    if (file == nullptr) {
+        std::cerr << "Failed to open file: " << filename << std::endl;
+        return false;
+    }
+
+    std::vector<char> chunk(csvChunkSize + 1);
+    std::vector<double> values(columns);
+    size_t carried = 0;      // Bytes of an unfinished line kept from the previous chunk
+    size_t lineNumber = 0;
+    bool ok = true;
+
+    while (ok) {
+        size_t bytesRead = std::fread(chunk.data() + carried, 1, csvChunkSize - carried, file);
+        size_t available = carried + bytesRead;
+        bool lastChunk = bytesRead == 0;
+        if (lastChunk && available == 0) {
+            break;
+        }
+        if (lastChunk) {
+            chunk[available++] = '\n';  // Final line without a newline
+        } else if (available == csvChunkSize && std::memchr(chunk.data(), '\n', available) == nullptr) {
+            std::cerr << "Line too long in " << filename << std::endl;
+            ok = false;
+            break;
+        }
+
+        size_t lineStart = 0;
+        char* newline;
+        while ((newline = static_cast<char*>(std::memchr(chunk.data() + lineStart, '\n',
+                                                         available - lineStart))) != nullptr) {
+            *newline = '\0';
+            char* cursor = chunk.data() + lineStart;
+            lineStart = static_cast<size_t>(newline - chunk.data()) + 1;
+            if (lineNumber++ == 0 || *cursor == '\0' || *cursor == '\r') {
+                continue;  // Header or blank line
+            }
+
+            int field = 0;
+            while (field < columns) {
+                char* end;
+                values[field++] = std::strtod(cursor, &end);
+                if (end == cursor) {
+                    break;
+                }
+                cursor = end;
+                if (*cursor != ',') {
+                    break;
+                }
+                ++cursor;
+            }
+            if (field != columns || (*cursor != '\0' && *cursor != '\r')) {
+                std::cerr << "Malformed row " << lineNumber << " in " << filename << std::endl;
+                ok = false;
+                break;
+            }
+            if (!handleRow(values.data())) {
+                std::cerr << "Invalid values in row " << lineNumber << " of " << filename << std::endl;
+                ok = false;
+                break;
+            }
+        }
+
+        if (lastChunk) {
+            break;
+        }
+        // Move the unfinished line to the front and read behind it
+        carried = available - lineStart;
+        std::memmove(chunk.data(), chunk.data() + lineStart, carried);
+    }
+
+    std::fclose(file);
+    return ok;
+}
+
+// True if value is a whole number in [0, limit]; false for NaN
+bool indexWithin(double value, size_t limit) {
+    return value >= 0.0 && value <= static_cast<double>(limit) && value == std::floor(value);
+}
+
+// Returns the slot for one point, or nullptr if the frame or point index is not a whole number
+// that continues the rows read so far. Rows are written frame by frame and point by point, so
+// each row adds at most one frame and one point, which bounds the memory a corrupt file can claim
+template <typename Point>
+Point* pointSlot(std::vector<std::vector<Point>>& points, double frame, double index) {
+    if (!indexWithin(frame, points.size())) {
+        return nullptr;
+    }
+    size_t frameIndex = static_cast<size_t>(frame);
+    if (frameIndex == points.size()) {
+        points.emplace_back();
+    }
+    std::vector<Point>& view = points[frameIndex];
+    if (!indexWithin(index, view.size())) {
+        return nullptr;
+    }
+    size_t pointIndex = static_cast<size_t>(index);
+    if (pointIndex == view.size()) {
+        view.emplace_back();
+    }
+    return &view[pointIndex];
+}
+
+} // namespace
+
 bool CSVUtil::save2DPoints(const std::string& filename,
                           const std::vector<std::vector<cv::Point2f>>& points) {
-    // Debug: find filename path
-    std::cout << "Attempting to save 2D points to file: " << filename << std::endl;
     createDirectory(filename);
-    std::ofstream file(filename.c_str());
-    if (!file.is_open()) {
+    ChunkedCsvWriter file(filename);
+    if (!file.isOpen()) {
         std::cerr << "Failed to open file: " << filename << std::endl;
         return false;
     }
     
     // Write header
-    file << "Frame,PointIndex,X,Y\n";
+    file.text("Frame,PointIndex,X,Y\n");
     
-    // Write data with high precision
-    file.precision(10);
+    // Floats are written with the fewest digits that still read back exactly
     for (size_t frame = 0; frame < points.size(); ++frame) {
         for (size_t i = 0; i < points[frame].size(); ++i) {
-            file << frame << "," 
-                 << i << "," 
-                 << points[frame][i].x << "," 
-                 << points[frame][i].y << "\n";
+            file.index(frame);
+            file.separator();
+            file.index(i);
+            file.separator();
+            file.number(points[frame][i].x);
+            file.separator();
+            file.number(points[frame][i].y);
+            file.endRow();
         }
     }
-    file.close();
+    if (!file.close()) {
+        std::cerr << "Failed to write file: " << filename << std::endl;
+        return false;
+    }
     return true;
 }
 
 bool CSVUtil::save3DPoints(const std::string& filename,
                           const std::vector<std::vector<cv::Point3f>>& points) {
     createDirectory(filename);
-    std::ofstream file(filename.c_str());
-    if (!file.is_open()) {
+    ChunkedCsvWriter file(filename);
+    if (!file.isOpen()) {
         std::cerr << "Failed to open file: " << filename << std::endl;
         return false;
     }
     
     // Write header
-    file << "Frame,PointIndex,X,Y,Z\n";
+    file.text("Frame,PointIndex,X,Y,Z\n");
     
-    // Write data with high precision
-    file.precision(10);
+    // Floats are written with the fewest digits that still read back exactly
     for (size_t frame = 0; frame < points.size(); ++frame) {
         for (size_t i = 0; i < points[frame].size(); ++i) {
-            file << frame << "," 
-                 << i << "," 
-                 << points[frame][i].x << ","
-                 << points[frame][i].y << ","
-                 << points[frame][i].z << "\n";
+            file.index(frame);
+            file.separator();
+            file.index(i);
+            file.separator();
+            file.number(points[frame][i].x);
+            file.separator();
+            file.number(points[frame][i].y);
+            file.separator();
+            file.number(points[frame][i].z);
+            file.endRow();
         }
     }
-    file.close();
+    if (!file.close()) {
+        std::cerr << "Failed to write file: " << filename << std::endl;
+        return false;
+    }
     return true;
 }
 
+bool CSVUtil::load2DPoints(const std::string& filename,
+                          std::vector<std::vector<cv::Point2f>>& points) {
+    points.clear();
+    return parseNumericCsv(filename, 4, [&points](const double* row) {
+        cv::Point2f* slot = pointSlot(points, row[0], row[1]);
+        if (slot != nullptr) {
+            *slot = cv::Point2f(static_cast<float>(row[2]), static_cast<float>(row[3]));
+        }
+        return slot != nullptr;
+    });
+}
+
+bool CSVUtil::load3DPoints(const std::string& filename,
+                          std::vector<std::vector<cv::Point3f>>& points) {
+    points.clear();
+    return parseNumericCsv(filename, 5, [&points](const double* row) {
+        cv::Point3f* slot = pointSlot(points, row[0], row[1]);
+        if (slot != nullptr) {
+            *slot = cv::Point3f(static_cast<float>(row[2]), static_cast<float>(row[3]),
+                                static_cast<float>(row[4]));
+        }
+        return slot != nullptr;
+    });
+}
+
 bool CSVUtil::saveSummary(const std::string& filename,
                          int numFrames,
                          const cv::Size& boardSize) {
@@ -94,4 +438,58 @@ bool CSVUtil::saveSummary(const std::string& filename,
     
     file.close();
     return true;
-}
\ No newline at end of file
+}
+
+bool CSVUtil::saveLatencySummary(const std::string& filename,
+                                 const LatencyProfiler& profiler) {
+    createDirectory(filename);
+    std::ofstream file(filename.c_str());
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file: " << filename << std::endl;
+        return false;
+    }
+
+    file << "Stage,Count,Mean_us,P50_us,P95_us,P99_us,Max_us\n";
+    for (int i = 0; i < LatencyProfiler::stageCount; ++i) {
+        LatencyProfiler::Stage stage = static_cast<LatencyProfiler::Stage>(i);
+        const LatencyHistogram& histogram = profiler.histogram(stage);
+        file << LatencyProfiler::stageName(stage) << ","
+             << histogram.count() << ","
+             << histogram.mean() << ","
+             << histogram.percentile(50) << ","
+             << histogram.percentile(95) << ","
+             << histogram.percentile(99) << ","
+             << histogram.max() << "\n";
+    }
+
+    file.close();
+    return true;
+}
+
+bool CSVUtil::saveLatencyHistogram(const std::string& filename,
+                                   const LatencyProfiler& profiler) {
+    createDirectory(filename);
+    std::ofstream file(filename.c_str());
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file: " << filename << std::endl;
+        return false;
+    }
+
+    file << "Stage,BucketLower_us,BucketUpper_us,Count\n";
+    for (int i = 0; i < LatencyProfiler::stageCount; ++i) {
+        LatencyProfiler::Stage stage = static_cast<LatencyProfiler::Stage>(i);
+        const LatencyHistogram& histogram = profiler.histogram(stage);
+        for (int bucket = 0; bucket < LatencyHistogram::bucketCount; ++bucket) {
+            if (histogram.bucketSamples(bucket) == 0) {
+                continue;
+            }
+            file << LatencyProfiler::stageName(stage) << ","
+                 << LatencyHistogram::bucketLowerBound(bucket) << ","
+                 << LatencyHistogram::bucketLowerBound(bucket + 1) << ","
+                 << histogram.bucketSamples(bucket) << "\n";
+        }
+    }
+
+    file.close();
+    return true;
+}
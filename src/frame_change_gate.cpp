@@ -0,0 +1,43 @@
+/**
+ * Yanting Lai (002955701)
+ * Fall 2024
+ * CS 5330 Project 4
+ * cpp file for frame change gate
+ */
+
+// frame_change_gate.cpp
+#include "frame_change_gate.h"
+
+FrameChangeGate::FrameChangeGate(double meanThreshold, double cellThreshold)
+    : meanThreshold(meanThreshold),
+      cellThreshold(cellThreshold) {
+}
+
+bool FrameChangeGate::isUnchanged(const cv::Mat& frame) {
+    if (frame.empty()) {
+        return false;
+    }
+
+    // Area averaging reads every pixel once, so each cell is the mean of a block of the frame
+    cv::resize(frame, scaled, cv::Size(signatureWidth, signatureHeight), 0, 0, cv::INTER_AREA);
+    if (scaled.channels() == 3) {
+        cv::cvtColor(scaled, signature, cv::COLOR_BGR2GRAY);
+    } else if (scaled.channels() == 4) {
+        cv::cvtColor(scaled, signature, cv::COLOR_BGRA2GRAY);
+    } else {
+        scaled.copyTo(signature);
+    }
+
+    if (!reference.empty() && referenceSize == frame.size()) {
+        cv::absdiff(signature, reference, difference);
+        double largest = 0.0;
+        cv::minMaxLoc(difference, nullptr, &largest);
+        if (cv::mean(difference)[0] <= meanThreshold && largest <= cellThreshold) {
+            return true;
+        }
+    }
+
+    signature.copyTo(reference);
+    referenceSize = frame.size();
+    return false;
+}
@@ -6,88 +6,221 @@
  */
 
 #include <opencv2/opencv.hpp>
+#include "harris_detector.h"
+#include "latency_profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <numeric>
+#include <string>
 
 int thresh = 150;
-int blockSize = 2; 
+int blockSize = 2;
 int kSize = 3;
+int perCell = 0;    // Strongest corners per grid cell, 0 keeps every maximum
+int maxCorners = 0; // Global cap before sub-pixel refinement, 0 for no cap
 
 void onTrackbarChange(int, void*) {}
 
-int main() {
-    cv::VideoCapture cap(0);
-    if (!cap.isOpened()) {
-        std::cerr << "Error: Could not open camera." << std::endl;
+// Camera, video file, single image or sorted image sequence
+class FrameSource {
+public:
+    bool openCamera(int index) {
+        if (!cap.open(index)) {
+            return false;
+        }
+        // Set camera properties
+        cap.set(cv::CAP_PROP_FRAME_WIDTH, 640);
+        cap.set(cv::CAP_PROP_FRAME_HEIGHT, 480);
+        cap.set(cv::CAP_PROP_FPS, 30);
+        return true;
+    }
+
+    bool openVideo(const std::string& path) { return cap.open(path); }
+
+    bool openImages(const std::string& pattern) {
+        cv::glob(pattern, files, false);
+        std::sort(files.begin(), files.end());
+        return !files.empty();
+    }
+
+    bool read(cv::Mat& frame) {
+        if (files.empty()) {
+            return cap.read(frame);
+        }
+        if (nextFile >= files.size()) {
+            return false;
+        }
+        frame = cv::imread(files[nextFile++]);
+        return !frame.empty();
+    }
+
+    // Starts again from the first frame; returns false for live cameras
+    bool rewind() {
+        if (!files.empty()) {
+            nextFile = 0;
+            return true;
+        }
+        return cap.set(cv::CAP_PROP_POS_FRAMES, 0);
+    }
+
+    void release() { cap.release(); }
+
+private:
+    cv::VideoCapture cap;
+    std::vector<cv::String> files;
+    size_t nextFile = 0;
+};
+
+static void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n"
+              << "Input (default: camera 0 with trackbars):\n"
+              << "  --image FILE        Single image\n"
+              << "  --video FILE        Video file\n"
+              << "  --sequence GLOB     Image sequence, processed in sorted order\n"
+              << "Parameters:\n"
+              << "  --threshold T       Response threshold in [0, 255] (default 150)\n"
+              << "  --block N           Block size, odd (default 5)\n"
+              << "  --ksize N           Sobel aperture, odd (default 7)\n"
+              << "  --per-cell N        Strongest corners per grid cell, 0 keeps all (default 0)\n"
+              << "  --max-corners N     Global corner cap, 0 for none (default 0)\n"
+              << "Run control:\n"
+              << "  --headless          No windows or trackbars\n"
+              << "  --repeat N          Process the input N times (default 1)\n"
+              << "  --threads N         OpenCV worker threads, 0 for the default\n"
+              << "  --output FILE       Write corners per frame as CSV\n";
+}
+
+int main(int argc, char** argv) {
+    std::string imagePath, videoPath, sequencePattern, outputPath;
+    bool headless = false;
+    int repeat = 1;
+    int threads = -1;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--image" && hasValue) {
+            imagePath = argv[++i];
+        } else if (arg == "--video" && hasValue) {
+            videoPath = argv[++i];
+        } else if (arg == "--sequence" && hasValue) {
+            sequencePattern = argv[++i];
+        } else if (arg == "--threshold" && hasValue) {
+            thresh = std::atoi(argv[++i]);
+        } else if (arg == "--block" && hasValue) {
+            blockSize = std::max(0, std::atoi(argv[++i]) / 2);
+        } else if (arg == "--ksize" && hasValue) {
+            kSize = std::max(0, std::atoi(argv[++i]) / 2);
+        } else if (arg == "--per-cell" && hasValue) {
+            perCell = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--max-corners" && hasValue) {
+            maxCorners = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--headless") {
+            headless = true;
+        } else if (arg == "--repeat" && hasValue) {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--threads" && hasValue) {
+            threads = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--output" && hasValue) {
+            outputPath = argv[++i];
+        } else {
+            printUsage(argv[0]);
+            return -1;
+        }
+    }
+
+    if (threads >= 0) {
+        cv::setNumThreads(threads);
+    }
+
+    FrameSource source;
+    bool opened;
+    if (!imagePath.empty()) {
+        opened = source.openImages(imagePath);
+    } else if (!videoPath.empty()) {
+        opened = source.openVideo(videoPath);
+    } else if (!sequencePattern.empty()) {
+        opened = source.openImages(sequencePattern);
+    } else if (headless) {
+        std::cerr << "Error: --headless needs --image, --video or --sequence." << std::endl;
+        return -1;
+    } else {
+        opened = source.openCamera(0);
+    }
+    if (!opened) {
+        std::cerr << "Error: Could not open input." << std::endl;
         return -1;
     }
 
-    // Set camera properties
-    cap.set(cv::CAP_PROP_FRAME_WIDTH, 640);
-    cap.set(cv::CAP_PROP_FRAME_HEIGHT, 480);
-    cap.set(cv::CAP_PROP_FPS, 30);
+    std::ofstream cornerLog;
+    if (!outputPath.empty()) {
+        cornerLog.open(outputPath.c_str());
+        if (!cornerLog.is_open()) {
+            std::cerr << "Failed to open file: " << outputPath << std::endl;
+            return -1;
+        }
+        cornerLog << "Frame,Index,X,Y\n";
+    }
 
-    // Create windows and trackbars for parameter tuning
-    cv::namedWindow("Harris Corner Detection", cv::WINDOW_AUTOSIZE);
-    cv::createTrackbar("Threshold", "Harris Corner Detection", &thresh, 255, onTrackbarChange);
-    cv::createTrackbar("Block Size", "Harris Corner Detection", &blockSize, 10, onTrackbarChange);
-    cv::createTrackbar("Kernel Size", "Harris Corner Detection", &kSize, 7, onTrackbarChange);
+    if (!headless) {
+        // Create windows and trackbars for parameter tuning
+        cv::namedWindow("Harris Corner Detection", cv::WINDOW_AUTOSIZE);
+        cv::createTrackbar("Threshold", "Harris Corner Detection", &thresh, 255, onTrackbarChange);
+        cv::createTrackbar("Block Size", "Harris Corner Detection", &blockSize, 10, onTrackbarChange);
+        cv::createTrackbar("Kernel Size", "Harris Corner Detection", &kSize, 7, onTrackbarChange);
+        cv::createTrackbar("Per Cell", "Harris Corner Detection", &perCell, 20, onTrackbarChange);
+        cv::createTrackbar("Max Corners", "Harris Corner Detection", &maxCorners, 2000, onTrackbarChange);
+    }
 
-    cv::Mat frame, gray, dst, dst_norm;
+    cv::Mat frame, gray;
     std::vector<cv::Point2f> corners;
+    HarrisDetector detector;
+    HarrisDetector::Parameters params;
+
+    // Per-frame timings, reported at the end
+    typedef std::chrono::steady_clock Clock;
+    LatencyHistogram detectLatency, refineLatency, frameLatency;
+    size_t frameIndex = 0;
+    size_t cornerTotal = 0;
+    int pass = 1;
+    Clock::time_point runStart = Clock::now();
 
     while (true) {
-        cap >> frame;
+        if (!source.read(frame)) {
+            // End of a file input; go round again if more passes were requested
+            if (pass < repeat && source.rewind() && source.read(frame)) {
+                ++pass;
+            } else {
+                break;
+            }
+        }
         if (frame.empty()) break;
 
+        Clock::time_point frameStart = Clock::now();
         cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
 
         // Ensure block size is odd
         int actualBlockSize = 2 * blockSize + 1;
         // Ensure kernel size is odd
         int actualKSize = 2 * kSize + 1;
-        
+
         // Harris parameters
-        double k = 0.04;
-        
-        // Pre-allocate matrices
-        if (dst.empty()) {
-            dst = cv::Mat::zeros(gray.size(), CV_32FC1);
-            dst_norm = cv::Mat::zeros(gray.size(), CV_32FC1);
-        }
+        params.blockSize = actualBlockSize;
+        params.apertureSize = actualKSize;
+        params.k = 0.04;
+        params.threshold = static_cast<float>(thresh);
 
-        // Apply Harris corner detection with dynamic parameters
-        cv::cornerHarris(gray, dst, actualBlockSize, actualKSize, k);
-        
-        // Normalize for visualization
-        cv::normalize(dst, dst_norm, 0, 255, cv::NORM_MINMAX, CV_32FC1);
-
-        corners.clear();
-        float threshold = static_cast<float>(thresh);
-
-        // More accurate corner detection
-        for(int i = actualBlockSize; i < dst_norm.rows - actualBlockSize; i++) {
-            const float* row = dst_norm.ptr<float>(i);
-            for(int j = actualBlockSize; j < dst_norm.cols - actualBlockSize; j++) {
-                if(row[j] > threshold) {
-                    // Check if it's a local maximum in 3x3 neighborhood
-                    bool isMax = true;
-                    for(int dy = -1; dy <= 1 && isMax; dy++) {
-                        for(int dx = -1; dx <= 1 && isMax; dx++) {
-                            if(dx == 0 && dy == 0) continue;
-                            if(dst_norm.at<float>(i+dy, j+dx) >= row[j]) {
-                                isMax = false;
-                            }
-                        }
-                    }
-                    if(isMax) {
-                        // Use sub-pixel accuracy
-                        cv::Point2f cornerPoint(j, i);
-                        corners.push_back(cornerPoint);
-                    }
-                }
-            }
-        }
+        // Bound the number of corners sent to cornerSubPix while keeping them spread out
+        params.maxPerCell = perCell;
+        params.maxCorners = maxCorners;
+
+        // Banded parallel response, then dilate-and-compare non-maximum suppression
+        detector.detect(gray, params, corners);
+        Clock::time_point detectEnd = Clock::now();
 
         // Refine corner locations using sub-pixel accuracy
         if(!corners.empty()) {
@@ -97,16 +230,33 @@ int main() {
                 cv::TermCriteria::EPS + cv::TermCriteria::COUNT, 40, 0.001);
             cv::cornerSubPix(gray, corners, winSize, zeroZone, criteria);
         }
+        Clock::time_point frameEnd = Clock::now();
+
+        detectLatency.record(std::chrono::duration_cast<std::chrono::microseconds>(detectEnd - frameStart).count());
+        refineLatency.record(std::chrono::duration_cast<std::chrono::microseconds>(frameEnd - detectEnd).count());
+        frameLatency.record(std::chrono::duration_cast<std::chrono::microseconds>(frameEnd - frameStart).count());
+        cornerTotal += corners.size();
+
+        if (cornerLog.is_open()) {
+            for (size_t i = 0; i < corners.size(); ++i) {
+                cornerLog << frameIndex << "," << i << "," << corners[i].x << "," << corners[i].y << "\n";
+            }
+        }
+        ++frameIndex;
+
+        if (headless) {
+            continue;
+        }
 
         // Draw detected corners
         cv::Mat display = frame.clone();
         for (const auto& corner : corners) {
             // Draw cross marker
-            cv::line(display, 
+            cv::line(display,
                     cv::Point(corner.x - 5, corner.y),
                     cv::Point(corner.x + 5, corner.y),
                     cv::Scalar(0, 0, 255), 2);
-            cv::line(display, 
+            cv::line(display,
                     cv::Point(corner.x, corner.y - 5),
                     cv::Point(corner.x, corner.y + 5),
                     cv::Scalar(0, 0, 255), 2);
@@ -119,9 +269,9 @@ int main() {
         float curr_fps = cv::getTickFrequency() / (curr_tick - prev_tick);
         fps = 0.9f * fps + 0.1f * curr_fps;
         prev_tick = curr_tick;
-        
+
         // Display information
-        cv::putText(display, 
+        cv::putText(display,
                     "FPS: " + std::to_string(static_cast<int>(fps)) +
                     " Corners: " + std::to_string(corners.size()) +
                     " Block: " + std::to_string(actualBlockSize) +
@@ -136,7 +286,30 @@ int main() {
         if (key == 27) break;
     }
 
-    cap.release();
-    cv::destroyAllWindows();
+    double elapsedSec = std::chrono::duration<double>(Clock::now() - runStart).count();
+    if (frameIndex > 0) {
+        std::cout << "\nHarris statistics:" << std::endl;
+        std::cout << "- Frames processed: " << frameIndex << " (" << pass << " pass"
+                  << (pass > 1 ? "es" : "") << ")" << std::endl;
+        std::cout << "- Corners per frame: " << std::fixed << std::setprecision(1)
+                  << static_cast<double>(cornerTotal) / frameIndex << std::endl;
+        std::cout << "- Throughput: " << frameIndex / elapsedSec << " fps" << std::endl;
+        std::cout << "- Latency (us)      mean      p50      p95      p99      max" << std::endl;
+        const LatencyHistogram* histograms[] = {&detectLatency, &refineLatency, &frameLatency};
+        const char* names[] = {"  detect   ", "  subpix   ", "  frame    "};
+        for (int i = 0; i < 3; ++i) {
+            std::cout << names[i] << std::setw(10) << histograms[i]->mean()
+                      << std::setw(9) << histograms[i]->percentile(50)
+                      << std::setw(9) << histograms[i]->percentile(95)
+                      << std::setw(9) << histograms[i]->percentile(99)
+                      << std::setw(9) << histograms[i]->max() << std::endl;
+        }
+        std::cout.unsetf(std::ios::floatfield);
+    }
+
+    source.release();
+    if (!headless) {
+        cv::destroyAllWindows();
+    }
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,139 @@
+/**
+ * Yanting Lai (002955701)
+ * Fall 2024
+ * CS 5330 Project 4
+ * cpp file for harris detector
+ */
+
+// harris_detector.cpp
+#include "harris_detector.h"
+#include <algorithm>
+
+void HarrisDetector::computeResponse(const cv::Mat& gray, const Parameters& params) {
+    const int blockSize = params.blockSize;
+    const int apertureSize = std::min(params.apertureSize, 7);  // Largest Sobel aperture OpenCV accepts
+    responseMap.create(gray.size(), CV_32FC1);
+
+    // Each band reads enough extra rows that its response matches a full-frame pass
+    const int halo = blockSize / 2 + apertureSize / 2 + 1;
+    const int minBandRows = 32;
+    const int bandCount = std::max(1, std::min(cv::getNumThreads(), gray.rows / minBandRows));
+
+    cv::parallel_for_(cv::Range(0, bandCount), [&](const cv::Range& range) {
+        cv::Mat bandResponse;
+        for (int band = range.start; band < range.end; ++band) {
+            int top = gray.rows * band / bandCount;
+            int bottom = gray.rows * (band + 1) / bandCount;
+            int haloTop = std::max(0, top - halo);
+            int haloBottom = std::min(gray.rows, bottom + halo);
+
+            cv::cornerHarris(gray.rowRange(haloTop, haloBottom), bandResponse,
+                             blockSize, apertureSize, params.k);
+            bandResponse.rowRange(top - haloTop, bottom - haloTop)
+                        .copyTo(responseMap.rowRange(top, bottom));
+        }
+    });
+}
+
+void HarrisDetector::detect(const cv::Mat& gray, const Parameters& params,
+                            std::vector<cv::Point2f>& corners) {
+    corners.clear();
+    computeResponse(gray, params);
+
+    double minValue, maxValue;
+    cv::minMaxLoc(responseMap, &minValue, &maxValue);
+    if (maxValue <= minValue) {
+        return;
+    }
+
+    // Same cut as thresholding a NORM_MINMAX copy scaled to [0, 255], without writing that copy
+    const double rawThreshold = minValue + (maxValue - minValue) * params.threshold / 255.0;
+
+    // Strict local maxima: larger than every one of the 8 neighbours, so a plateau of equal
+    // responses (common on synthetic or saturated boards) yields no duplicates
+    if (neighbourKernel.empty()) {
+        neighbourKernel = cv::Mat::ones(3, 3, CV_8U);
+        neighbourKernel.at<uchar>(1, 1) = 0;
+    }
+    cv::dilate(responseMap, dilated, neighbourKernel);
+    cv::compare(responseMap, dilated, maximaMask, cv::CMP_GT);
+    cv::compare(responseMap, rawThreshold, aboveMask, cv::CMP_GT);
+    cv::bitwise_and(maximaMask, aboveMask, maximaMask);
+
+    // Skip a border of blockSize pixels, where the response is dominated by extrapolation
+    const int border = params.blockSize;
+    cv::Rect inner(border, border, gray.cols - 2 * border, gray.rows - 2 * border);
+    if (inner.width <= 0 || inner.height <= 0) {
+        return;
+    }
+    cv::findNonZero(maximaMask(inner), locations);
+
+    if (params.maxPerCell > 0 || params.maxCorners > 0) {
+        selectStrongest(params, gray.size(), border, corners);
+        return;
+    }
+
+    corners.reserve(locations.size());
+    for (const auto& location : locations) {
+        corners.push_back(cv::Point2f(static_cast<float>(location.x + border),
+                                      static_cast<float>(location.y + border)));
+    }
+}
+
+void HarrisDetector::selectStrongest(const Parameters& params, const cv::Size& imageSize, int border,
+                                     std::vector<cv::Point2f>& corners) {
+    const int gridCols = std::max(1, params.gridCols);
+    const int gridRows = std::max(1, params.gridRows);
+    const int cellCount = gridCols * gridRows;
+    auto stronger = [](const Candidate& a, const Candidate& b) { return a.response > b.response; };
+
+    // Tag every maximum with its response and grid cell
+    candidates.clear();
+    candidates.reserve(locations.size());
+    cellStart.assign(cellCount + 1, 0);
+    for (const auto& offset : locations) {
+        cv::Point location(offset.x + border, offset.y + border);
+        int cell = (location.y * gridRows / imageSize.height) * gridCols +
+                   location.x * gridCols / imageSize.width;
+        candidates.push_back(Candidate{responseMap.at<float>(location), location, cell});
+        ++cellStart[cell + 1];
+    }
+
+    // Counting sort by cell, then partial selection inside each cell
+    for (int cell = 0; cell < cellCount; ++cell) {
+        cellStart[cell + 1] += cellStart[cell];
+    }
+    grouped.resize(candidates.size());
+    std::vector<int>& next = cellStart;
+    for (const auto& candidate : candidates) {
+        grouped[next[candidate.cell]++] = candidate;
+    }
+    // next[cell] now holds the end of each cell, which is the start of the following one
+
+    candidates.clear();
+    int cellBegin = 0;
+    for (int cell = 0; cell < cellCount; ++cell) {
+        int cellEnd = next[cell];
+        auto first = grouped.begin() + cellBegin;
+        auto last = grouped.begin() + cellEnd;
+        if (params.maxPerCell > 0 && cellEnd - cellBegin > params.maxPerCell) {
+            std::nth_element(first, first + (params.maxPerCell - 1), last, stronger);
+            last = first + params.maxPerCell;
+        }
+        candidates.insert(candidates.end(), first, last);
+        cellBegin = cellEnd;
+    }
+
+    // Global cap keeps the strongest survivors across all cells
+    if (params.maxCorners > 0 && candidates.size() > static_cast<size_t>(params.maxCorners)) {
+        std::nth_element(candidates.begin(), candidates.begin() + (params.maxCorners - 1),
+                         candidates.end(), stronger);
+        candidates.resize(params.maxCorners);
+    }
+
+    corners.reserve(candidates.size());
+    for (const auto& candidate : candidates) {
+        corners.push_back(cv::Point2f(static_cast<float>(candidate.location.x),
+                                      static_cast<float>(candidate.location.y)));
+    }
+}
@@ -0,0 +1,87 @@
+/**
+ * Yanting Lai (002955701)
+ * Fall 2024
+ * CS 5330 Project 4
+ * cpp file for latency profiler
+ */
+
+// latency_profiler.cpp
+#include "latency_profiler.h"
+#include <algorithm>
+#include <cmath>
+
+LatencyHistogram::LatencyHistogram()
+    : total(0),
+      sum(0),
+      maximum(0) {
+    std::fill(counts, counts + bucketCount, 0);
+}
+
+int LatencyHistogram::bucketIndex(uint64_t micros) {
+    if (micros < static_cast<uint64_t>(subBuckets)) {
+        return static_cast<int>(micros);
+    }
+
+    // Position of the highest set bit, at least 4 here
+    int exponent = 0;
+    for (uint64_t v = micros; v > 1; v >>= 1) {
+        ++exponent;
+    }
+
+    // The four bits below the leading one select the sub-bucket
+    int sub = static_cast<int>((micros >> (exponent - 4)) & (subBuckets - 1));
+    int index = subBuckets * (exponent - 3) + sub;
+    return std::min(index, bucketCount - 1);
+}
+
+uint64_t LatencyHistogram::bucketLowerBound(int bucket) {
+    if (bucket < subBuckets) {
+        return static_cast<uint64_t>(bucket);
+    }
+    int exponent = bucket / subBuckets + 3;
+    uint64_t sub = static_cast<uint64_t>(bucket % subBuckets);
+    return (subBuckets + sub) << (exponent - 4);
+}
+
+void LatencyHistogram::record(uint64_t micros) {
+    ++counts[bucketIndex(micros)];
+    ++total;
+    sum += micros;
+    maximum = std::max(maximum, micros);
+}
+
+uint64_t LatencyHistogram::percentile(double percentile) const {
+    if (total == 0) {
+        return 0;
+    }
+
+    // Smallest bucket whose cumulative count reaches the requested rank
+    uint64_t rank = static_cast<uint64_t>(std::ceil(percentile / 100.0 * total));
+    rank = std::max<uint64_t>(1, std::min(rank, total));
+    uint64_t seen = 0;
+    for (int bucket = 0; bucket < bucketCount; ++bucket) {
+        seen += counts[bucket];
+        if (seen >= rank) {
+            return std::min(bucketLowerBound(bucket), maximum);
+        }
+    }
+    return maximum;
+}
+
+void LatencyProfiler::record(Stage stage, std::chrono::steady_clock::duration elapsed) {
+    auto micros = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    histograms[static_cast<int>(stage)].record(static_cast<uint64_t>(std::max<decltype(micros)>(0, micros)));
+}
+
+const char* LatencyProfiler::stageName(Stage stage) {
+    switch (stage) {
+        case Stage::CVT_COLOR:      return "cvtColor";
+        case Stage::FIND_CORNERS:   return "findChessboardCorners";
+        case Stage::CORNER_SUBPIX:  return "cornerSubPix";
+        case Stage::SOLVE_PNP:      return "solvePnP";
+        case Stage::PROJECT_POINTS: return "projectPoints";
+        case Stage::DRAW:           return "draw";
+        case Stage::DISPLAY:        return "display";
+        default:                    return "unknown";
+    }
+}
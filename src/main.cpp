@@ -7,19 +7,158 @@
 
 // main.cpp
 #include "augmented_reality.h"
+#include "bounded_queue.h"
+#include "frame_change_gate.h"
+#include "pose_stream.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
 #include <iomanip>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
-int main() {
-    cv::VideoCapture cap(0);
+typedef std::chrono::steady_clock Clock;
+
+// A frame travelling through the capture -> detect -> render pipeline
+struct FramePacket {
+    cv::Mat frame;                  // Captured frame, annotated in place by the detect stage
+    Clock::time_point captureTime;  // When the frame left the camera
+    bool poseValid = false;         // True if rvec/tvec hold a pose for this frame
+    cv::Mat rvec, tvec;             // Board pose for this frame
+    FrameStatus status;             // Detection state for the status overlay
+    std::vector<AugmentedReality::TargetDetection> targets;  // Per-board results in multi-target mode
+};
+
+int main(int argc, char** argv) {
+    // Optional: --resume FILE continues a saved session (calibration_data/session.bin),
+    // --camera N selects the capture device, --undistort remaps frames once calibrated,
+    // --mesh FILE[@x,y,z[,scale]] adds an OBJ wireframe at a board position (repeatable),
+    // --target WxH tracks one more board of that size once calibrated (repeatable),
+    // --budget-ms MS sets the per-frame cost the quality controller holds (0 disables it),
+    // --publish-shm NAME and --publish-socket PATH stream every pose to other processes
+    std::string resumePath;
+    std::string publishShm, publishSocket;
+    double budgetMs = -1.0;
+    int cameraIndex = 0;
+    bool undistort = false;
+    std::vector<std::string> meshSpecs;
+    std::vector<cv::Size> targetSizes;
+    int targetWidth = 0, targetHeight = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--resume" && i + 1 < argc) {
+            resumePath = argv[++i];
+        } else if (arg == "--camera" && i + 1 < argc) {
+            cameraIndex = std::atoi(argv[++i]);
+        } else if (arg == "--undistort") {
+            undistort = true;
+        } else if (arg == "--mesh" && i + 1 < argc) {
+            meshSpecs.push_back(argv[++i]);
+        } else if (arg == "--target" && i + 1 < argc &&
+                   std::sscanf(argv[i + 1], "%dx%d", &targetWidth, &targetHeight) == 2 &&
+                   targetWidth > 1 && targetHeight > 1) {
+            targetSizes.push_back(cv::Size(targetWidth, targetHeight));
+            ++i;
+        } else if (arg == "--budget-ms" && i + 1 < argc) {
+            budgetMs = std::max(0.0, std::atof(argv[++i]));
+        } else if (arg == "--publish-shm" && i + 1 < argc) {
+            publishShm = argv[++i];
+        } else if (arg == "--publish-socket" && i + 1 < argc) {
+            publishSocket = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--resume SESSION_FILE] [--camera N] [--undistort]"
+                      << " [--mesh FILE[@x,y,z[,scale]]]... [--target WxH]... [--budget-ms MS]"
+                      << " [--publish-shm NAME] [--publish-socket PATH]" << std::endl;
+            return -1;
+        }
+    }
+
+    // Poses go out from the detection thread, before rendering, so consumers do not wait on display
+    PoseStream::PosePublisher publisher;
+    if (!publishShm.empty() && !publisher.openSharedMemory(publishShm)) {
+        return -1;
+    }
+    if (!publishSocket.empty() && !publisher.openSocket(publishSocket)) {
+        return -1;
+    }
+
+    cv::VideoCapture cap(cameraIndex);
     if(!cap.isOpened()) {
         std::cerr << "Error: Could not open camera." << std::endl;
         return -1;
     }
+    // Saved intrinsics are only valid for the camera and resolution they were calibrated at
+    const std::string cameraId = std::to_string(cameraIndex);
+    const cv::Size resolution(static_cast<int>(cap.get(cv::CAP_PROP_FRAME_WIDTH)),
+                              static_cast<int>(cap.get(cv::CAP_PROP_FRAME_HEIGHT)));
+    const std::string intrinsicsPath = "calibration_data/intrinsics.yml";
 
     cv::namedWindow("Chessboard Detection", cv::WINDOW_AUTOSIZE);
     
     AugmentedReality ar(8, 6);
+    ar.setTrackingMode(AugmentedReality::TrackingMode::ROI);
+    ar.setSteadyStateMode(true);
+    ar.setPoseTrackingEnabled(true);
+    ar.setAutoRecalibration(true);
+    if (!resumePath.empty() && !ar.resumeSession(resumePath, resolution)) {
+        return -1;
+    }
+    if (!ar.isCalibrated() && ar.loadIntrinsics(intrinsicsPath, cameraId, resolution)) {
+        std::cout << "Loaded intrinsics for camera " << cameraId << " at " << resolution.width
+                  << "x" << resolution.height << " from " << intrinsicsPath << std::endl;
+    }
+    ar.setUndistortInput(undistort);
+
+    // Extra virtual objects are drawn together with the pyramid in one projection pass
+    const cv::Scalar meshColors[] = {cv::Scalar(0, 255, 255), cv::Scalar(255, 0, 255), cv::Scalar(255, 255, 0)};
+    for (size_t i = 0; i < meshSpecs.size(); ++i) {
+        size_t at = meshSpecs[i].find('@');
+        cv::Point3f offset;
+        float scale = 1.0f;
+        if (at != std::string::npos) {
+            std::sscanf(meshSpecs[i].c_str() + at + 1, "%f,%f,%f,%f", &offset.x, &offset.y, &offset.z, &scale);
+        }
+        if (!ar.getScene().loadMesh(meshSpecs[i].substr(0, at), offset, scale, meshColors[i % 3])) {
+            return -1;
+        }
+    }
+
+    // Each extra board gets its own copy of the scene; all are found in one pass per frame
+    for (const auto& size : targetSizes) {
+        ar.addTarget(size);
+    }
+    const bool multiTarget = !targetSizes.empty();
+
+    // Quality steps down when detection, pose and drawing overrun the camera frame interval
+    if (budgetMs < 0.0) {
+        double fps = cap.get(cv::CAP_PROP_FPS);
+        budgetMs = fps > 0.0 ? 1000.0 / fps : 1000.0 / 30.0;
+    }
+    const bool adaptiveQuality = budgetMs > 0.0;
+    QualityController quality(std::chrono::microseconds(static_cast<int64_t>(budgetMs * 1000.0)));
+    if (multiTarget) {
+        // Extra targets are only found by detection, so every frame must be detected
+        quality.setLowestLevel(QualityController::Level::FAST_REFINEMENT);
+    }
+    Clock::duration lastDrawCost(0);  // Drawing time of the latest displayed frame, under arMutex
+
+    // Saved frames are encoded and written in the background as soon as they are saved
+    SessionWriter sessionWriter("calibration_data");
+    ar.setSessionWriter(&sessionWriter);
+
+    // Pose printing happens on the telemetry thread, a few times per second
+    TelemetrySink telemetry(std::chrono::milliseconds(200));
+    ar.setTelemetrySink(&telemetry);
+
+    // Per-stage timings; each stage is updated under arMutex or only by the display thread
+    LatencyProfiler profiler;
+    ar.setProfiler(&profiler);
+    bool showOverlay = true;
     
     std::cout << "\n=== Chessboard Detection and Pose Estimation ===\n";
     std::cout << "Step 1: Gather calibration images\n";
@@ -27,45 +166,213 @@ int main() {
     std::cout << "Step 3: View real-time pose estimation\n\n";
     std::cout << "Controls:\n";
     std::cout << "  's' - Save current frame for calibration\n";
-    std::cout << "  'c' - Calibrate camera (requires at least 5 frames)\n";
+    std::cout << "  'c' - Calibrate camera in the background (requires at least 5 frames)\n";
+    std::cout << "  'k' - Toggle automatic keyframe selection (keeps up to 30 views)\n";
+    std::cout << "  'u' - Toggle undistorted input (needs calibration; pauses saving views)\n";
+    std::cout << "  'o' - Toggle status overlay\n";
     std::cout << "  'ESC' - Exit and save all data\n\n";
     std::cout << "Instructions:\n";
     std::cout << "1. Move the chessboard to different positions\n";
     std::cout << "2. Press 's' when corners are detected (shown in green)\n";
     std::cout << "3. Collect at least 5 frames from different angles\n";
     std::cout << "4. Press 'c' to calibrate\n";
-    std::cout << "5. After calibration, pose will show automatically\n\n";
+    std::cout << "5. After calibration, pose will show automatically\n";
+    std::cout << "6. Frames saved after that refine the calibration in the background\n\n";
     
-    cv::Mat frame;
-    while(true) {
-        cap >> frame;
-        if(frame.empty()) {
-            std::cerr << "Error: Blank frame grabbed" << std::endl;
-            break;
+    // Each stage runs on its own thread; queues keep only the newest frames
+    const size_t queueCapacity = 2;
+    BoundedQueue<FramePacket> capturedFrames(queueCapacity);
+    BoundedQueue<FramePacket> processedFrames(queueCapacity);
+    std::atomic<bool> running(true);
+    std::mutex arMutex;  // Guards ar between the detect stage and key handling/rendering
+    std::atomic<bool> forceDetection(false);  // Set by keys that change what detection produces
+
+    // Stage 1: camera capture
+    std::thread captureThread([&]() {
+        while (running) {
+            FramePacket packet;
+            cap >> packet.frame;
+            packet.captureTime = Clock::now();
+            if (packet.frame.empty()) {
+                std::cerr << "Error: Blank frame grabbed" << std::endl;
+                running = false;
+                break;
+            }
+            capturedFrames.push(std::move(packet));
         }
+        capturedFrames.close();
+    });
+
+    // Stage 2: chessboard detection and pose estimation
+    std::thread detectThread([&]() {
+        FramePacket packet;
+        uint64_t frameNumber = 0;
+        FrameChangeGate changeGate;
+        FramePacket cached;         // Detection result of the last frame that changed
+        bool haveCached = false;
+        while (capturedFrames.pop(packet)) {
+            {
+                std::lock_guard<std::mutex> lock(arMutex);
+                Clock::time_point start = Clock::now();
+                ++frameNumber;
 
-        bool patternFound = ar.detectChessboard(frame);
+                // A static scene reuses the last result; key presses and a running calibration
+                // need detectChessboard to run, so they bypass the gate
+                if (forceDetection.exchange(false) || ar.isCalibrating()) {
+                    changeGate.invalidate();
+                }
+                const bool reused = changeGate.isUnchanged(packet.frame) && haveCached;
+                if (reused) {
+                    cached.frame.copyTo(packet.frame);
+                    packet.poseValid = cached.poseValid;
+                    packet.rvec = cached.rvec;
+                    packet.tvec = cached.tvec;
+                    packet.status = cached.status;
+                    packet.targets = cached.targets;
+                } else if (adaptiveQuality && quality.skipDetection(frameNumber)) {
+                    packet.poseValid = ar.extrapolatePose(packet.frame, packet.rvec, packet.tvec);
+                } else {
+                    // Once calibrated the extra targets are found in the same pass as the primary board
+                    bool patternFound = ar.detectChessboard(packet.frame);
+                    if (patternFound && ar.isCalibrated() && ar.getCorners().size() >= 4) {
+                        packet.poseValid = ar.computePose(packet.rvec, packet.tvec);
+                    }
+                    if (multiTarget) {
+                        packet.targets = ar.getTargetDetections();
+                    }
+                }
+                if (!reused) {
+                    ar.finishFrame();
+                    packet.status = ar.getFrameStatus();
+                    packet.frame.copyTo(cached.frame);
+                    cached.poseValid = packet.poseValid;
+                    cached.rvec = packet.rvec;
+                    cached.tvec = packet.tvec;
+                    cached.status = packet.status;
+                    cached.targets = packet.targets;
+                    haveCached = true;
+                }
+                if (publisher.isOpen()) {
+                    // Numbered by captured frame, so readers can tell dropped records from reused poses
+                    PoseStream::PoseRecord record = PoseStream::makeRecord(packet.status, packet.captureTime);
+                    record.frameIndex = frameNumber;
+                    publisher.publish(record);
+                }
 
-        if (patternFound && ar.isCalibrated() && ar.getCorners().size() >= 4) {
-            cv::Mat rvec, tvec;
-            if (ar.computePose(rvec, tvec)) {
-                // ar.draw3DAxis(frame, rvec, tvec); // Draw 3D axis if pose is computed
-                ar.drawVirtualObject(frame, rvec, tvec); // Draw the virtual object
+                // Each draw is counted once, with the next frame through detection
+                Clock::duration frameCost = Clock::now() - start + lastDrawCost;
+                lastDrawCost = Clock::duration(0);
+                if (adaptiveQuality && quality.recordFrame(frameCost)) {
+                    ar.setQualityLevel(quality.level());
+                    std::cout << "\nQuality: " << QualityController::levelName(quality.level())
+                              << " (frame cost " << quality.averageCostMs() << " ms, budget "
+                              << budgetMs << " ms)" << std::endl;
+                }
             }
+            processedFrames.push(std::move(packet));
         }
+        processedFrames.close();
+    });
+
+    // Stage 3: rendering and display stay on the main thread for HighGUI
+    size_t displayedFrames = 0;
+    double latencySumMs = 0.0;
+    double latencyMaxMs = 0.0;
+    Clock::time_point firstDisplay;
+    FramePacket packet;
+    while (running) {
+        if (processedFrames.popFor(packet, std::chrono::milliseconds(30))) {
+            if (packet.poseValid || !packet.targets.empty()) {
+                std::lock_guard<std::mutex> lock(arMutex);
+                Clock::time_point drawStart = Clock::now();
+                if (packet.poseValid) {
+                    // Projected with the distortion model of this packet, which may predate a 'u' toggle
+                    // ar.draw3DAxis(packet.frame, packet.rvec, packet.tvec, packet.status.undistorted); // Draw 3D axis if pose is computed
+                    ar.drawVirtualObject(packet.frame, packet.rvec, packet.tvec, packet.status.undistorted); // Draw the virtual object
+                }
+                ar.drawTargets(packet.frame, packet.targets, packet.status.undistorted);
+                lastDrawCost = Clock::now() - drawStart;
+            }
 
-        cv::imshow("Chessboard Detection", frame);
+            if (showOverlay) {
+                AugmentedReality::drawOverlay(packet.frame, packet.status);
+            }
 
-        char key = (char)cv::waitKey(30);
-        if(key == 27) { // ESC
+            {
+                ScopedStageTimer timer(&profiler, LatencyProfiler::Stage::DISPLAY);
+                cv::imshow("Chessboard Detection", packet.frame);
+            }
+
+            // Glass-to-glass latency: camera read to hand-off for display
+            double latencyMs = std::chrono::duration<double, std::milli>(
+                                   Clock::now() - packet.captureTime).count();
+            if (displayedFrames == 0) {
+                firstDisplay = Clock::now();
+            }
+            ++displayedFrames;
+            latencySumMs += latencyMs;
+            latencyMaxMs = std::max(latencyMaxMs, latencyMs);
+        } else if (!running) {
             break;
+        }
+
+        char key = (char)cv::waitKey(1);
+        if(key == 27) { // ESC
+            running = false;
         } else if(key == 's' || key == 'S') {
+            std::lock_guard<std::mutex> lock(arMutex);
             ar.saveCalibrationData();
+            forceDetection = true;
         } else if (key == 'c' || key == 'C') {
-            ar.calibrateCamera();
+            std::lock_guard<std::mutex> lock(arMutex);
+            ar.calibrateCameraAsync();
+            forceDetection = true;
+        } else if (key == 'k' || key == 'K') {
+            std::lock_guard<std::mutex> lock(arMutex);
+            ar.setAutoKeyframes(!ar.isAutoKeyframesEnabled());
+            forceDetection = true;
+            std::cout << "\nAutomatic keyframes " << (ar.isAutoKeyframesEnabled() ? "on" : "off") << std::endl;
+        } else if (key == 'u' || key == 'U') {
+            std::lock_guard<std::mutex> lock(arMutex);
+            ar.setUndistortInput(!ar.isUndistortInputEnabled());
+            forceDetection = true;
+            std::cout << "\nUndistorted input " << (ar.isUndistortInputEnabled() ? "on" : "off") << std::endl;
+        } else if (key == 'o' || key == 'O') {
+            showOverlay = !showOverlay;
         }
     }
 
+    running = false;
+    capturedFrames.close();
+    processedFrames.close();
+    captureThread.join();
+    detectThread.join();
+
+    if (displayedFrames > 1) {
+        double elapsedSec = std::chrono::duration<double>(Clock::now() - firstDisplay).count();
+        std::cout << "\n\nPipeline statistics:" << std::endl;
+        std::cout << "- Frames displayed: " << displayedFrames << std::endl;
+        std::cout << "- Throughput: " << std::fixed << std::setprecision(1)
+                  << (displayedFrames - 1) / elapsedSec << " fps" << std::endl;
+        std::cout << "- Latency (capture to display): mean " 
+                  << latencySumMs / displayedFrames << " ms, max " 
+                  << latencyMaxMs << " ms" << std::endl;
+        std::cout << "- Frames dropped: " << capturedFrames.droppedCount() << " before detection, "
+                  << processedFrames.droppedCount() << " before display" << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+    }
+    if (publisher.isOpen()) {
+        std::cout << "- Poses published: " << publisher.publishedCount() << " ("
+                  << publisher.ringDroppedCount() << " dropped by the shared memory ring, "
+                  << publisher.socketDroppedCount() << " not sent to the socket)" << std::endl;
+    }
+
+    // Latency histograms go next to the session data
+    if (CSVUtil::saveLatencySummary("calibration_data/latency.csv", profiler) &&
+        CSVUtil::saveLatencyHistogram("calibration_data/latency_histogram.csv", profiler)) {
+        std::cout << "\nSaved per-stage latency to ./calibration_data/latency.csv" << std::endl;
+    }
+
     if (ar.getSavedFramesCount() > 0) {
         std::cout << "\nSaving calibration data..." << std::endl;
         ar.saveAllData("calibration_data");
@@ -76,6 +383,8 @@ int main() {
         std::cout << "  ├── corners.csv (2D corner coordinates)\n";
         std::cout << "  ├── points.csv (3D world coordinates)\n";
         std::cout << "  ├── summary.csv (Session information)\n";
+        std::cout << "  ├── session.bin (Binary session, reopen with --resume)\n";
+        std::cout << "  ├── latency.csv, latency_histogram.csv (Per-stage timings)\n";
         if (ar.isCalibrated()) {
             std::cout << "  ├── camera_params.yml (Camera parameters)\n";
         }
@@ -84,6 +393,11 @@ int main() {
         std::cout << "\nNo frames were saved during this session." << std::endl;
     }
 
+    // Next start with this camera and resolution skips calibration
+    if (ar.saveIntrinsics(intrinsicsPath, cameraId, resolution)) {
+        std::cout << "\nSaved intrinsics for camera " << cameraId << " to " << intrinsicsPath << std::endl;
+    }
+
     cap.release();
     cv::destroyAllWindows();
     
@@ -0,0 +1,123 @@
+/**
+ * Yanting Lai (002955701)
+ * Fall 2024
+ * CS 5330 Project 4
+ * sample reader for the pose stream
+ */
+
+// pose_reader.cpp
+#include "pose_stream.h"
+#include "latency_profiler.h"
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+static std::atomic<bool> stopRequested(false);
+
+static void handleSignal(int) {
+    stopRequested = true;
+}
+
+static void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " (--shm NAME | --socket PATH) [options]\n"
+              << "Options:\n"
+              << "  --count N        Stop after N records (default 0, run until Ctrl+C)\n"
+              << "  --quiet          Print only the periodic statistics, not the poses\n";
+}
+
+static void printLatency(const char* label, const LatencyHistogram& histogram) {
+    std::printf("  %-18s mean %8.1f us  p50 %6llu us  p99 %6llu us  max %6llu us\n", label,
+                histogram.mean(),
+                static_cast<unsigned long long>(histogram.percentile(50.0)),
+                static_cast<unsigned long long>(histogram.percentile(99.0)),
+                static_cast<unsigned long long>(histogram.max()));
+}
+
+int main(int argc, char** argv) {
+    std::string sharedName, socketPath;
+    uint64_t maxRecords = 0;
+    bool quiet = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--shm" && hasValue) {
+            sharedName = argv[++i];
+        } else if (arg == "--socket" && hasValue) {
+            socketPath = argv[++i];
+        } else if (arg == "--count" && hasValue) {
+            maxRecords = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--quiet") {
+            quiet = true;
+        } else {
+            printUsage(argv[0]);
+            return -1;
+        }
+    }
+    if (sharedName.empty() == socketPath.empty()) {
+        printUsage(argv[0]);
+        return -1;
+    }
+
+    PoseStream::PoseSubscriber subscriber;
+    bool opened = sharedName.empty() ? subscriber.openSocket(socketPath)
+                                     : subscriber.openSharedMemory(sharedName);
+    if (!opened) {
+        return -1;
+    }
+    std::signal(SIGINT, handleSignal);
+    std::signal(SIGTERM, handleSignal);
+    std::cout << "Reading poses from " << (sharedName.empty() ? socketPath : sharedName)
+              << " (Ctrl+C to stop)" << std::endl;
+
+    // Publish-to-read is the transport latency; capture-to-read adds the detection pipeline
+    LatencyHistogram transportLatency, pipelineLatency;
+    uint64_t received = 0, gaps = 0, lastFrame = 0;
+    auto lastReport = std::chrono::steady_clock::now();
+    PoseStream::PoseRecord record;
+    while (!stopRequested && (maxRecords == 0 || received < maxRecords)) {
+        if (subscriber.receive(record, std::chrono::milliseconds(200))) {
+            const uint64_t now = PoseStream::nowNs();
+            transportLatency.record((now - record.publishTimeNs) / 1000);
+            if (record.captureTimeNs != 0) {
+                pipelineLatency.record((now - record.captureTimeNs) / 1000);
+            }
+            // Frame indices that skip ahead mean records were dropped or frames were not published
+            if (received > 0 && record.frameIndex > lastFrame + 1) {
+                gaps += record.frameIndex - lastFrame - 1;
+            }
+            lastFrame = record.frameIndex;
+            ++received;
+
+            if (!quiet && (record.flags & PoseStream::poseValid)) {
+                std::printf("frame %llu  R [%.3f %.3f %.3f]  T [%.3f %.3f %.3f]  quality %.3f%s\n",
+                            static_cast<unsigned long long>(record.frameIndex),
+                            record.rvec[0], record.rvec[1], record.rvec[2],
+                            record.tvec[0], record.tvec[1], record.tvec[2], record.quality,
+                            (record.flags & PoseStream::extrapolated) ? " (predicted)" : "");
+            }
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastReport >= std::chrono::seconds(1)) {
+            lastReport = now;
+            std::printf("received %llu, missing frames %llu, dropped by full ring %llu\n",
+                        static_cast<unsigned long long>(received), static_cast<unsigned long long>(gaps),
+                        static_cast<unsigned long long>(subscriber.ringDroppedCount()));
+            std::fflush(stdout);
+        }
+    }
+
+    std::cout << "\nRecords received: " << received << std::endl;
+    if (received > 0) {
+        std::cout << "Latency:" << std::endl;
+        printLatency("publish to read", transportLatency);
+        if (pipelineLatency.count() > 0) {
+            printLatency("capture to read", pipelineLatency);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,256 @@
+/**
+ * Yanting Lai (002955701)
+ * Fall 2024
+ * CS 5330 Project 4
+ * cpp file for pose stream
+ */
+
+// pose_stream.cpp
+#include "pose_stream.h"
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace PoseStream {
+
+static_assert(sizeof(PoseRecord) == 80, "PoseRecord layout is part of the stream format");
+
+// POSIX shared memory names start with a single slash
+static std::string sharedMemoryName(const std::string& name) {
+    return (name.empty() || name[0] != '/') ? "/" + name : name;
+}
+
+// Fills a Unix socket address; false if the path does not fit
+static bool socketAddress(const std::string& path, sockaddr_un& address) {
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Socket path too long: " << path << std::endl;
+        return false;
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+PoseRecord makeRecord(const FrameStatus& status, std::chrono::steady_clock::time_point captureTime) {
+    PoseRecord record;
+    std::memset(&record, 0, sizeof(record));
+    record.captureTimeNs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        captureTime.time_since_epoch()).count());
+    record.frameIndex = status.frameIndex;
+    if (status.poseValid) {
+        for (int i = 0; i < 3; ++i) {
+            record.rvec[i] = status.rvec[i];
+            record.tvec[i] = status.tvec[i];
+        }
+        record.flags |= poseValid;
+        if (status.poseExtrapolated) {
+            record.flags |= extrapolated;
+        } else if (status.reprojectionError >= 0.0f) {
+            record.quality = 1.0f / (1.0f + status.reprojectionError);
+        }
+    }
+    return record;
+}
+
+PosePublisher::PosePublisher()
+    : shared(nullptr),
+      socketFd(-1),
+      published(0),
+      socketDropped(0) {
+}
+
+PosePublisher::~PosePublisher() {
+    if (shared != nullptr) {
+        munmap(shared, sizeof(SharedPoseRing));
+        shm_unlink(sharedName.c_str());
+    }
+    if (socketFd >= 0) {
+        ::close(socketFd);
+    }
+}
+
+bool PosePublisher::openSharedMemory(const std::string& name) {
+    // The head and tail counters are shared between processes, which needs lock-free atomics
+    if (!std::atomic<size_t>().is_lock_free() || !std::atomic<uint64_t>().is_lock_free()) {
+        std::cerr << "Shared memory pose stream needs lock-free atomics" << std::endl;
+        return false;
+    }
+
+    // A fresh object each run, so a reader never sees the counters of an earlier producer
+    sharedName = sharedMemoryName(name);
+    shm_unlink(sharedName.c_str());
+    int fd = shm_open(sharedName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        std::cerr << "Failed to create shared memory " << sharedName << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    void* address = MAP_FAILED;
+    if (ftruncate(fd, sizeof(SharedPoseRing)) == 0) {
+        address = mmap(nullptr, sizeof(SharedPoseRing), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (address == MAP_FAILED) {
+        std::cerr << "Failed to map shared memory " << sharedName << ": " << std::strerror(errno) << std::endl;
+        shm_unlink(sharedName.c_str());
+        return false;
+    }
+
+    shared = new (address) SharedPoseRing();
+    shared->version = currentVersion;
+    shared->recordSize = sizeof(PoseRecord);
+    shared->dropped.store(0, std::memory_order_relaxed);
+    // Readers check the magic last, so it only appears once the ring is initialized
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(shared->magic, magic, sizeof(magic));
+    return true;
+}
+
+bool PosePublisher::openSocket(const std::string& path) {
+    sockaddr_un address;
+    if (!socketAddress(path, address)) {
+        return false;
+    }
+    socketFd = ::socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (socketFd < 0) {
+        std::cerr << "Failed to create socket: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    // Sends must never wait for the reader
+    fcntl(socketFd, F_SETFL, fcntl(socketFd, F_GETFL, 0) | O_NONBLOCK);
+    socketPath = path;
+    return true;
+}
+
+void PosePublisher::publish(PoseRecord record) {
+    record.publishTimeNs = nowNs();
+    ++published;
+
+    if (shared != nullptr && !shared->ring.push(record)) {
+        shared->dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (socketFd >= 0) {
+        sockaddr_un address;
+        socketAddress(socketPath, address);
+        // Fails right away while no reader is bound or its receive buffer is full
+        ssize_t sent = ::sendto(socketFd, &record, sizeof(record), 0,
+                                reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+        if (sent != static_cast<ssize_t>(sizeof(record))) {
+            ++socketDropped;
+        }
+    }
+}
+
+PoseSubscriber::PoseSubscriber()
+    : shared(nullptr),
+      socketFd(-1) {
+}
+
+PoseSubscriber::~PoseSubscriber() {
+    if (shared != nullptr) {
+        munmap(shared, sizeof(SharedPoseRing));
+    }
+    if (socketFd >= 0) {
+        ::close(socketFd);
+        ::unlink(socketPath.c_str());
+    }
+}
+
+bool PoseSubscriber::openSharedMemory(const std::string& name) {
+    const std::string objectName = sharedMemoryName(name);
+    int fd = shm_open(objectName.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        std::cerr << "Failed to open shared memory " << objectName << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    struct stat st;
+    void* address = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) == sizeof(SharedPoseRing)) {
+        address = mmap(nullptr, sizeof(SharedPoseRing), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (address == MAP_FAILED) {
+        std::cerr << "Shared memory " << objectName << " is not a pose ring of this version" << std::endl;
+        return false;
+    }
+
+    SharedPoseRing* ring = static_cast<SharedPoseRing*>(address);
+    bool valid = std::memcmp(ring->magic, magic, sizeof(magic)) == 0;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (!valid || ring->version != currentVersion || ring->recordSize != sizeof(PoseRecord)) {
+        std::cerr << "Shared memory " << objectName << " is not a pose ring of this version" << std::endl;
+        munmap(address, sizeof(SharedPoseRing));
+        return false;
+    }
+    shared = ring;
+    return true;
+}
+
+bool PoseSubscriber::openSocket(const std::string& path) {
+    sockaddr_un address;
+    if (!socketAddress(path, address)) {
+        return false;
+    }
+    socketFd = ::socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (socketFd < 0) {
+        std::cerr << "Failed to create socket: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    ::unlink(path.c_str());
+    if (::bind(socketFd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        std::cerr << "Failed to bind " << path << ": " << std::strerror(errno) << std::endl;
+        ::close(socketFd);
+        socketFd = -1;
+        return false;
+    }
+    socketPath = path;
+    return true;
+}
+
+bool PoseSubscriber::poll(PoseRecord& record) {
+    if (shared != nullptr) {
+        return shared->ring.pop(record);
+    }
+    if (socketFd >= 0) {
+        return ::recv(socketFd, &record, sizeof(record), MSG_DONTWAIT) == static_cast<ssize_t>(sizeof(record));
+    }
+    return false;
+}
+
+bool PoseSubscriber::receive(PoseRecord& record, std::chrono::milliseconds timeout) {
+    if (socketFd >= 0) {
+        pollfd descriptor;
+        descriptor.fd = socketFd;
+        descriptor.events = POLLIN;
+        descriptor.revents = 0;
+        if (::poll(&descriptor, 1, static_cast<int>(timeout.count())) <= 0) {
+            return false;
+        }
+        return poll(record);
+    }
+
+    // The ring has nothing to wait on: spin briefly for low latency, then back off
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    for (int attempt = 0; ; ++attempt) {
+        if (poll(record)) {
+            return true;
+        }
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        if (attempt >= 1000) {
+            usleep(50);
+        }
+    }
+}
+
+} // namespace PoseStream
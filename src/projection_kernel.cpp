@@ -0,0 +1,170 @@
+/**
+ * Yanting Lai (002955701)
+ * Fall 2024
+ * CS 5330 Project 4
+ * cpp file for projection kernel
+ */
+
+// projection_kernel.cpp
+#include "projection_kernel.h"
+#include <opencv2/core/hal/intrin.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace ProjectionKernel {
+
+// Element i of a continuous CV_32F or CV_64F matrix
+static float element(const cv::Mat& m, int i) {
+    return m.depth() == CV_32F ? m.ptr<float>()[i] : static_cast<float>(m.ptr<double>()[i]);
+}
+
+Model makeModel(const cv::Mat& rvec, const cv::Mat& tvec, const cv::Mat& cameraMatrix,
+                const cv::Mat& distCoeffs, float negligiblePixels) {
+    Model model;
+    cv::Matx33d R;
+    cv::Rodrigues(rvec, R);
+    for (int i = 0; i < 9; ++i) {
+        model.r[i] = static_cast<float>(R.val[i]);
+    }
+    for (int i = 0; i < 3; ++i) {
+        model.t[i] = element(tvec, i);
+    }
+    model.fx = element(cameraMatrix, 0);
+    model.fy = element(cameraMatrix, 4);
+    model.cx = element(cameraMatrix, 2);
+    model.cy = element(cameraMatrix, 5);
+
+    std::fill(model.k, model.k + 12, 0.0f);
+    const int count = std::min<int>(12, static_cast<int>(distCoeffs.total()));
+    for (int i = 0; i < count; ++i) {
+        model.k[i] = element(distCoeffs, i);
+    }
+
+    // First-order bound on the shift at the image corner, taking the principal point as the center
+    const float* k = model.k;
+    const float r2 = (model.cx * model.cx) / (model.fx * model.fx) + (model.cy * model.cy) / (model.fy * model.fy);
+    const float r4 = r2 * r2;
+    const float r6 = r4 * r2;
+    const float radial = std::fabs(k[0]) * r2 + std::fabs(k[1]) * r4 + std::fabs(k[4]) * r6 +
+                         std::fabs(k[5]) * r2 + std::fabs(k[6]) * r4 + std::fabs(k[7]) * r6;
+    const float tangential = 3.0f * (std::fabs(k[2]) + std::fabs(k[3])) * r2;
+    const float prism = (std::fabs(k[8]) + std::fabs(k[10])) * r2 + (std::fabs(k[9]) + std::fabs(k[11])) * r4;
+    const float shift = std::max(model.fx, model.fy) * (radial * std::sqrt(r2) + tangential + prism);
+    model.distorted = !(shift < negligiblePixels);
+    return model;
+}
+
+// Scalar version of the SIMD loop body, used for the tail
+template <bool Distorted>
+static inline void projectOne(const Model& m, float x, float y, float z, float& u, float& v, float& depth) {
+    const float X = m.r[0] * x + m.r[1] * y + m.r[2] * z + m.t[0];
+    const float Y = m.r[3] * x + m.r[4] * y + m.r[5] * z + m.t[1];
+    const float Z = m.r[6] * x + m.r[7] * y + m.r[8] * z + m.t[2];
+    const float invZ = Z > 1e-6f ? 1.0f / Z : 0.0f;
+    float xd = X * invZ;
+    float yd = Y * invZ;
+    if (Distorted) {
+        const float* k = m.k;
+        const float xn = xd, yn = yd;
+        const float r2 = xn * xn + yn * yn;
+        const float r4 = r2 * r2;
+        const float r6 = r4 * r2;
+        const float radial = (1.0f + k[0] * r2 + k[1] * r4 + k[4] * r6) /
+                             (1.0f + k[5] * r2 + k[6] * r4 + k[7] * r6);
+        const float xy2 = 2.0f * xn * yn;
+        xd = xn * radial + k[2] * xy2 + k[3] * (r2 + 2.0f * xn * xn) + k[8] * r2 + k[9] * r4;
+        yd = yn * radial + k[2] * (r2 + 2.0f * yn * yn) + k[3] * xy2 + k[10] * r2 + k[11] * r4;
+    }
+    u = m.fx * xd + m.cx;
+    v = m.fy * yd + m.cy;
+    depth = Z;
+}
+
+template <bool Distorted>
+static void projectAll(const Model& m, const float* xs, const float* ys, const float* zs, size_t n,
+                       float* us, float* vs, float* depth) {
+    size_t i = 0;
+#if CV_SIMD
+    using namespace cv;
+    const int lanes = v_float32::nlanes;
+    const v_float32 r00 = vx_setall_f32(m.r[0]), r01 = vx_setall_f32(m.r[1]), r02 = vx_setall_f32(m.r[2]);
+    const v_float32 r10 = vx_setall_f32(m.r[3]), r11 = vx_setall_f32(m.r[4]), r12 = vx_setall_f32(m.r[5]);
+    const v_float32 r20 = vx_setall_f32(m.r[6]), r21 = vx_setall_f32(m.r[7]), r22 = vx_setall_f32(m.r[8]);
+    const v_float32 tx = vx_setall_f32(m.t[0]), ty = vx_setall_f32(m.t[1]), tz = vx_setall_f32(m.t[2]);
+    const v_float32 fx = vx_setall_f32(m.fx), fy = vx_setall_f32(m.fy);
+    const v_float32 cx = vx_setall_f32(m.cx), cy = vx_setall_f32(m.cy);
+    const v_float32 one = vx_setall_f32(1.0f), two = vx_setall_f32(2.0f);
+    const v_float32 zero = vx_setzero_f32(), nearPlane = vx_setall_f32(1e-6f);
+    const v_float32 k1 = vx_setall_f32(m.k[0]), k2 = vx_setall_f32(m.k[1]);
+    const v_float32 p1 = vx_setall_f32(m.k[2]), p2 = vx_setall_f32(m.k[3]);
+    const v_float32 k3 = vx_setall_f32(m.k[4]), k4 = vx_setall_f32(m.k[5]);
+    const v_float32 k5 = vx_setall_f32(m.k[6]), k6 = vx_setall_f32(m.k[7]);
+    const v_float32 s1 = vx_setall_f32(m.k[8]), s2 = vx_setall_f32(m.k[9]);
+    const v_float32 s3 = vx_setall_f32(m.k[10]), s4 = vx_setall_f32(m.k[11]);
+
+    for (; i + lanes <= n; i += lanes) {
+        const v_float32 x = vx_load(xs + i), y = vx_load(ys + i), z = vx_load(zs + i);
+        const v_float32 X = v_fma(r00, x, v_fma(r01, y, v_fma(r02, z, tx)));
+        const v_float32 Y = v_fma(r10, x, v_fma(r11, y, v_fma(r12, z, ty)));
+        const v_float32 Z = v_fma(r20, x, v_fma(r21, y, v_fma(r22, z, tz)));
+
+        // Points behind the camera get invZ = 0 instead of a division by a tiny depth
+        const v_float32 invZ = v_select(Z > nearPlane, one / Z, zero);
+        v_float32 xd = X * invZ;
+        v_float32 yd = Y * invZ;
+        if (Distorted) {
+            const v_float32 xn = xd, yn = yd;
+            const v_float32 r2 = v_fma(xn, xn, yn * yn);
+            const v_float32 r4 = r2 * r2;
+            const v_float32 r6 = r4 * r2;
+            const v_float32 numerator = v_fma(k1, r2, v_fma(k2, r4, v_fma(k3, r6, one)));
+            const v_float32 denominator = v_fma(k4, r2, v_fma(k5, r4, v_fma(k6, r6, one)));
+            const v_float32 radial = numerator / denominator;
+            const v_float32 xy2 = two * xn * yn;
+            xd = v_fma(xn, radial, v_fma(p1, xy2, v_fma(p2, v_fma(two * xn, xn, r2), v_fma(s1, r2, s2 * r4))));
+            yd = v_fma(yn, radial, v_fma(p1, v_fma(two * yn, yn, r2), v_fma(p2, xy2, v_fma(s3, r2, s4 * r4))));
+        }
+        v_store(us + i, v_fma(fx, xd, cx));
+        v_store(vs + i, v_fma(fy, yd, cy));
+        v_store(depth + i, Z);
+    }
+    vx_cleanup();
+#endif
+    for (; i < n; ++i) {
+        projectOne<Distorted>(m, xs[i], ys[i], zs[i], us[i], vs[i], depth[i]);
+    }
+}
+
+void projectPoints(const Model& model, const float* xs, const float* ys, const float* zs, size_t n,
+                   float* us, float* vs, float* depth) {
+    if (model.distorted) {
+        projectAll<true>(model, xs, ys, zs, n, us, vs, depth);
+    } else {
+        projectAll<false>(model, xs, ys, zs, n, us, vs, depth);
+    }
+}
+
+double compareWithOpenCV(const cv::Mat& rvec, const cv::Mat& tvec, const cv::Mat& cameraMatrix,
+                         const cv::Mat& distCoeffs, const std::vector<cv::Point3f>& points,
+                         float negligiblePixels) {
+    std::vector<float> xs, ys, zs;
+    for (const auto& point : points) {
+        xs.push_back(point.x);
+        ys.push_back(point.y);
+        zs.push_back(point.z);
+    }
+    std::vector<float> us(points.size()), vs(points.size()), depth(points.size());
+    Model model = makeModel(rvec, tvec, cameraMatrix, distCoeffs, negligiblePixels);
+    projectPoints(model, xs.data(), ys.data(), zs.data(), points.size(), us.data(), vs.data(), depth.data());
+
+    std::vector<cv::Point2f> reference;
+    cv::projectPoints(points, rvec, tvec, cameraMatrix, distCoeffs, reference);
+    double maxError = 0.0;
+    for (size_t i = 0; i < points.size(); ++i) {
+        maxError = std::max(maxError, std::hypot(static_cast<double>(us[i] - reference[i].x),
+                                                 static_cast<double>(vs[i] - reference[i].y)));
+    }
+    return maxError;
+}
+
+} // namespace ProjectionKernel
@@ -0,0 +1,103 @@
+/**
+ * Yanting Lai (002955701)
+ * Fall 2024
+ * CS 5330 Project 4
+ * cpp file for quality controller
+ */
+
+// quality_controller.cpp
+#include "quality_controller.h"
+#include <algorithm>
+
+namespace {
+const double smoothing = 0.2;          // Weight of the newest frame in the average
+const double headroom = 0.6;           // Step up below this fraction of the budget
+const int stepDownFrames = 5;          // Overrun frames before lowering quality
+const int minStepUpFrames = 60;        // Headroom frames before raising quality
+const int maxStepUpFrames = 960;       // Longest wait after repeated failed step ups
+}
+
+QualityController::QualityController(std::chrono::microseconds frameBudget)
+    : frameBudget(frameBudget),
+      current(Level::FULL),
+      lowest(Level::ALTERNATE_FRAMES),
+      smoothedMicros(0.0),
+      hasSample(false),
+      framesOverBudget(0),
+      framesWithHeadroom(0),
+      framesSinceChange(0),
+      stepUpFrames(minStepUpFrames),
+      lastChangeUp(false) {
+}
+
+bool QualityController::recordFrame(std::chrono::steady_clock::duration cost) {
+    const double micros = static_cast<double>(
+        std::chrono::duration_cast<std::chrono::microseconds>(cost).count());
+    smoothedMicros = hasSample ? smoothedMicros + smoothing * (micros - smoothedMicros) : micros;
+    hasSample = true;
+    ++framesSinceChange;
+
+    // Going back to detecting every frame doubles the work, so it needs twice the headroom
+    const double budgetMicros = static_cast<double>(frameBudget.count());
+    double stepUpBelow = headroom * budgetMicros;
+    if (current == Level::ALTERNATE_FRAMES) {
+        stepUpBelow *= 0.5;
+    }
+
+    if (smoothedMicros > budgetMicros) {
+        ++framesOverBudget;
+        framesWithHeadroom = 0;
+    } else if (smoothedMicros < stepUpBelow) {
+        ++framesWithHeadroom;
+        framesOverBudget = 0;
+    } else {
+        framesOverBudget = 0;
+        framesWithHeadroom = 0;
+    }
+
+    if (framesOverBudget >= stepDownFrames && current < lowest) {
+        // A step up that could not be held is retried less often
+        if (lastChangeUp && framesSinceChange < stepUpFrames) {
+            stepUpFrames = std::min(2 * stepUpFrames, maxStepUpFrames);
+        }
+        changeLevel(static_cast<Level>(static_cast<int>(current) + 1), false);
+        return true;
+    }
+    if (framesWithHeadroom >= stepUpFrames && current != Level::FULL) {
+        changeLevel(static_cast<Level>(static_cast<int>(current) - 1), true);
+        return true;
+    }
+
+    // A level held for a long time means the load changed; react quickly again
+    if (framesSinceChange >= 4 * maxStepUpFrames) {
+        stepUpFrames = minStepUpFrames;
+    }
+    return false;
+}
+
+void QualityController::setLowestLevel(Level level) {
+    lowest = level;
+    if (current > lowest) {
+        changeLevel(lowest, true);
+    }
+}
+
+void QualityController::changeLevel(Level level, bool up) {
+    current = level;
+    lastChangeUp = up;
+    // The average restarts so the old level's cost does not trigger another step
+    hasSample = false;
+    framesOverBudget = 0;
+    framesWithHeadroom = 0;
+    framesSinceChange = 0;
+}
+
+const char* QualityController::levelName(Level level) {
+    switch (level) {
+        case Level::FULL:             return "full";
+        case Level::COARSE_DETECTION: return "coarse detection";
+        case Level::FAST_REFINEMENT:  return "fast refinement";
+        case Level::ALTERNATE_FRAMES: return "alternate frames";
+    }
+    return "unknown";
+}
@@ -0,0 +1,122 @@
+/**
+ * Yanting Lai (002955701)
+ * Fall 2024
+ * CS 5330 Project 4
+ * cpp file for session writer
+ */
+
+// session_writer.cpp
+#include "session_writer.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+SessionWriter::SessionWriter(const std::string& directory, size_t threadCount)
+    : outputDirectory(directory),
+      pool(threadCount) {
+    if (!createDirectories(directory)) {
+        std::cerr << "Failed to create directory: " << directory << std::endl;
+    }
+}
+
+SessionWriter::~SessionWriter() {
+    wait();
+}
+
+bool SessionWriter::createDirectories(const std::string& path) {
+    if (path.empty()) {
+        return true;
+    }
+
+    // Create each prefix in turn; existing components are fine
+    size_t position = 0;
+    while (position != std::string::npos) {
+        position = path.find_first_of("/\\", position + 1);
+        std::string prefix = path.substr(0, position);
+        if (mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST) {
+            return false;
+        }
+    }
+
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+void SessionWriter::writeFrame(const std::string& filename, const cv::Mat& frame) {
+    writeFile(filename, [frame](const std::string& path) {
+        return cv::imwrite(path, frame);
+    });
+}
+
+void SessionWriter::writeFile(const std::string& filename, std::function<bool(const std::string&)> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++counts.queued;
+    }
+    const std::string path = outputDirectory + "/" + filename;
+    pool.submit([this, filename, path, task] {
+        bool ok = false;
+        try {
+            ok = task(path);
+        } catch (const std::exception& e) {
+            // cv::Exception, bad_alloc or anything a file task throws
+            std::cerr << "Failed to write " << path << ": " << e.what() << std::endl;
+        } catch (...) {
+            std::cerr << "Failed to write " << path << ": unknown exception" << std::endl;
+        }
+        // Always counted, otherwise wait() would never see the file finish
+        finish(filename, ok);
+    });
+}
+
+void SessionWriter::finish(const std::string& filename, bool ok) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (ok) {
+            ++counts.written;
+            // A rewrite that succeeds clears the earlier failure of the same file
+            failures.erase(std::remove(failures.begin(), failures.end(), filename), failures.end());
+        } else {
+            ++counts.failed;
+            failures.push_back(filename);
+        }
+    }
+    if (!ok) {
+        std::cerr << "Failed to save " << outputDirectory << "/" << filename << std::endl;
+    }
+    changed.notify_all();
+}
+
+SessionWriter::Progress SessionWriter::progress() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return counts;
+}
+
+size_t SessionWriter::wait(const std::function<void(const Progress&)>& onProgress) {
+    std::unique_lock<std::mutex> lock(mutex);
+    auto done = [this] { return counts.written + counts.failed == counts.queued; };
+    while (!changed.wait_for(lock, std::chrono::milliseconds(200), done)) {
+        if (onProgress) {
+            Progress snapshot = counts;
+            lock.unlock();
+            onProgress(snapshot);
+            lock.lock();
+        }
+    }
+
+    Progress snapshot = counts;
+    lock.unlock();
+    if (onProgress) {
+        onProgress(snapshot);
+    }
+    return snapshot.failed;
+}
+
+std::vector<std::string> SessionWriter::failedFiles() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return failures;
+}
@@ -0,0 +1,90 @@
+/**
+ * Yanting Lai (002955701)
+ * Fall 2024
+ * CS 5330 Project 4
+ * cpp file for telemetry
+ */
+
+// telemetry.cpp
+#include "telemetry.h"
+#include <cstdio>
+#include <iostream>
+
+TelemetrySink::TelemetrySink(std::chrono::milliseconds printInterval, const std::string& logPath)
+    : dropped(0),
+      printInterval(printInterval),
+      havePose(false),
+      stopping(false) {
+    if (!logPath.empty()) {
+        log.open(logPath.c_str());
+        if (!log.is_open()) {
+            std::cerr << "Failed to open file: " << logPath << std::endl;
+        } else {
+            log << "Frame,Found,Calibrated,PoseValid,Saved,R0,R1,R2,T0,T1,T2\n";
+        }
+    }
+    consumer = std::thread([this] { consumerLoop(); });
+}
+
+TelemetrySink::~TelemetrySink() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    stopRequested.notify_all();
+    consumer.join();
+}
+
+void TelemetrySink::publish(const FrameStatus& status) {
+    if (!ring.push(status)) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void TelemetrySink::consumerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        stopRequested.wait_for(lock, printInterval, [this] { return stopping; });
+        lock.unlock();
+
+        drain();
+        if (havePose) {
+            havePose = false;
+            // Format locally so the shared stream's precision flags stay untouched
+            char line[160];
+            std::snprintf(line, sizeof(line),
+                          "\rRotation vector: [%.2f, %.2f, %.2f] Translation vector: [%.2f, %.2f, %.2f]     ",
+                          latestPose.rvec[0], latestPose.rvec[1], latestPose.rvec[2],
+                          latestPose.tvec[0], latestPose.tvec[1], latestPose.tvec[2]);
+            std::cout << line << std::flush;
+        }
+
+        lock.lock();
+    }
+    lock.unlock();
+
+    // Pick up anything published right before shutdown
+    drain();
+    if (log.is_open()) {
+        log.flush();
+    }
+}
+
+void TelemetrySink::drain() {
+    FrameStatus status;
+    while (ring.pop(status)) {
+        if (status.poseValid) {
+            latestPose = status;
+            havePose = true;
+        }
+        if (log.is_open()) {
+            log << status.frameIndex << ","
+                << status.patternFound << ","
+                << status.calibrated << ","
+                << status.poseValid << ","
+                << status.savedFrames << ","
+                << status.rvec[0] << "," << status.rvec[1] << "," << status.rvec[2] << ","
+                << status.tvec[0] << "," << status.tvec[1] << "," << status.tvec[2] << "\n";
+        }
+    }
+}
@@ -0,0 +1,145 @@
+/**
+ * Yanting Lai (002955701)
+ * Fall 2024
+ * CS 5330 Project 4
+ * cpp file for virtual scene
+ */
+
+// virtual_scene.cpp
+#include "virtual_scene.h"
+#include "projection_kernel.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+size_t VirtualScene::addObject(const std::string& name, const std::vector<cv::Point3f>& vertices,
+                               const std::vector<Edge>& objectEdges, const cv::Point3f& offset,
+                               float scale, const cv::Scalar& color, int thickness) {
+    const uint32_t base = static_cast<uint32_t>(xs.size());
+    for (const auto& vertex : vertices) {
+        xs.push_back(offset.x + scale * vertex.x);
+        ys.push_back(offset.y + scale * vertex.y);
+        zs.push_back(offset.z + scale * vertex.z);
+    }
+    us.resize(xs.size());
+    vs.resize(xs.size());
+    depths.resize(xs.size());
+
+    Object object;
+    object.name = name;
+    object.firstEdge = static_cast<uint32_t>(edges.size());
+    object.edgeCount = 0;
+    object.color = color;
+    object.thickness = thickness;
+    for (const auto& edge : objectEdges) {
+        if (edge.from >= vertices.size() || edge.to >= vertices.size()) {
+            continue;  // Skip lines that refer past the object's vertices
+        }
+        edges.push_back(Edge{base + edge.from, base + edge.to});
+        ++object.edgeCount;
+    }
+    objects.push_back(object);
+    return objects.size() - 1;
+}
+
+bool VirtualScene::loadMesh(const std::string& path, const cv::Point3f& offset, float scale,
+                            const cv::Scalar& color, int thickness) {
+    std::ifstream file(path.c_str());
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file: " << path << std::endl;
+        return false;
+    }
+
+    std::vector<cv::Point3f> vertices;
+    std::vector<Edge> meshEdges;
+    std::vector<long> polygon;
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream tokens(line);
+        std::string type;
+        tokens >> type;
+        if (type == "v") {
+            cv::Point3f vertex;
+            tokens >> vertex.x >> vertex.y >> vertex.z;
+            vertices.push_back(vertex);
+        } else if (type == "l" || type == "f") {
+            // Indices are 1-based, negative ones count back from the newest vertex;
+            // "f 1/2/3" style entries keep only the vertex index
+            polygon.clear();
+            std::string entry;
+            while (tokens >> entry) {
+                long index = std::strtol(entry.c_str(), nullptr, 10);
+                index = index < 0 ? static_cast<long>(vertices.size()) + index : index - 1;
+                if (index >= 0 && index < static_cast<long>(vertices.size())) {
+                    polygon.push_back(index);
+                }
+            }
+            for (size_t i = 0; i + 1 < polygon.size(); ++i) {
+                meshEdges.push_back(Edge{static_cast<uint32_t>(polygon[i]),
+                                         static_cast<uint32_t>(polygon[i + 1])});
+            }
+            // Faces are closed outlines
+            if (type == "f" && polygon.size() > 2) {
+                meshEdges.push_back(Edge{static_cast<uint32_t>(polygon.back()),
+                                         static_cast<uint32_t>(polygon.front())});
+            }
+        }
+    }
+
+    if (meshEdges.empty()) {
+        std::cerr << "No lines or faces in mesh: " << path << std::endl;
+        return false;
+    }
+
+    // Faces sharing an edge would otherwise draw it twice
+    for (auto& edge : meshEdges) {
+        if (edge.from > edge.to) {
+            std::swap(edge.from, edge.to);
+        }
+    }
+    std::sort(meshEdges.begin(), meshEdges.end(), [](const Edge& a, const Edge& b) {
+        return a.from != b.from ? a.from < b.from : a.to < b.to;
+    });
+    meshEdges.erase(std::unique(meshEdges.begin(), meshEdges.end(), [](const Edge& a, const Edge& b) {
+        return a.from == b.from && a.to == b.to;
+    }), meshEdges.end());
+
+    addObject(path, vertices, meshEdges, offset, scale, color, thickness);
+    return true;
+}
+
+void VirtualScene::clear() {
+    xs.clear();
+    ys.clear();
+    zs.clear();
+    us.clear();
+    vs.clear();
+    depths.clear();
+    edges.clear();
+    objects.clear();
+}
+
+void VirtualScene::project(const cv::Mat& rvec, const cv::Mat& tvec,
+                           const cv::Mat& cameraMatrix, const cv::Mat& distCoeffs) {
+    // Rotation matrix and distortion check once per frame, then one SIMD pass over all vertices
+    ProjectionKernel::Model model = ProjectionKernel::makeModel(rvec, tvec, cameraMatrix, distCoeffs);
+    ProjectionKernel::projectPoints(model, xs.data(), ys.data(), zs.data(), xs.size(),
+                                    us.data(), vs.data(), depths.data());
+}
+
+void VirtualScene::draw(cv::Mat& frame) const {
+    const float nearPlane = 1e-6f;
+    for (const auto& object : objects) {
+        const uint32_t end = object.firstEdge + object.edgeCount;
+        for (uint32_t e = object.firstEdge; e < end; ++e) {
+            const Edge& edge = edges[e];
+            if (depths[edge.from] <= nearPlane || depths[edge.to] <= nearPlane) {
+                continue;
+            }
+            cv::line(frame, cv::Point2f(us[edge.from], vs[edge.from]),
+                     cv::Point2f(us[edge.to], vs[edge.to]), object.color, object.thickness);
+        }
+    }
+}